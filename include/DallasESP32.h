@@ -1,9 +1,297 @@
 #pragma once
 #include "Dallas.h"
+#include "OnewireESP32Bus.h"
+#include "mgos_dallas_esp32.h"
+#include "onewire_bus_lock.h"
 
 class DallasESP32 : public Dallas {
  public:
   DallasESP32(uint8_t pin, uint8_t rmt_rx, uint8_t rmt_tx);
 
+  /*
+   * Select the 1-Wire backend: with MGOS_DALLAS_BACKEND_RMT `ch_a` and `ch_b`
+   * are the RMT rx and tx channels, with MGOS_DALLAS_BACKEND_UART `ch_a` is
+   * the UART number and `ch_b` is not used.
+   */
+  DallasESP32(uint8_t pin, enum mgos_dallas_backend backend, uint8_t ch_a,
+              uint8_t ch_b = 0);
+
+  /*
+   * Use the bus `bus`, e.g. a compile-time specialized OnewireESP32T. The
+   * DallasESP32 takes the ownership of `bus` and deletes it.
+   */
+  explicit DallasESP32(OnewireESP32Bus *bus);
+
   ~DallasESP32();
+
+  /*
+   * Search the devices with the bus locked. The search yields the bus to
+   * more urgent tasks between two devices and resumes where it stopped.
+   * Hides Dallas::begin().
+   */
+  void begin(void);
+
+  /*
+   * Search the bus in one pass and update the devices table iterated by
+   * publishReadings(), scheduleTick() and broadcastConfig(). begin() does
+   * it, call it again to pick up added or removed devices.
+   * Returns the number of devices found.
+   */
+  int refreshDevices(void);
+
+  /*
+   * Take the bus for a sequence of transactions with the `priority` (FreeRTOS
+   * priority of the calling task by default), see onewire_bus_lock.h.
+   * All the methods of this class lock the bus themselves, this is only
+   * needed around calls of the Dallas methods when other tasks use the bus.
+   * Calls can be nested, every lockBus() needs an unlockBus().
+   */
+  void lockBus(int priority = OW_BUS_LOCK_TASK_PRIO);
+  void unlockBus(void);
+
+  /*
+   * Convert and read the temperature (centi-degrees C) of the device
+   * `deviceAddress` only, e.g. from a control loop. The bus is released
+   * during the conversion and, when called from a task with a higher priority,
+   * the read runs between two devices of a long scan of another task.
+   * Returns false if the device didn't answer.
+   */
+  bool readTemperature(const uint8_t *deviceAddress, int32_t *temp);
+
+  /*
+   * A bus found with exactly one device by a search (begin(), getAddress())
+   * addresses it with Skip ROM instead of MATCH ROM. publishReadings(),
+   * scheduleTick(), requestTemperatures(), requestTemperaturesByAddress()
+   * and readTemperature() search it again every OW_SKIP_ROM_VERIFY_MS, before
+   * their transactions, and the temperatures are always read in full with
+   * their CRC while Skip ROM is used.
+   * Set the only device `deviceAddress` known in advance, e.g. persisted
+   * from getSingleDevice(), NULL to forget it.
+   * getSingleDevice() returns false if the bus is not known to have only one
+   * device.
+   */
+  void setSingleDevice(const uint8_t *deviceAddress);
+  bool getSingleDevice(uint8_t *deviceAddress);
+
+  /*
+   * Read `count` bytes from the memory of the device `deviceAddress`
+   * (e.g. DS2431, DS28EC20), starting at `memAddress`, into `buf`.
+   * If `deviceAddress` is NULL, the only device on the bus is addressed.
+   * If `checkCrc` is true, the CRC16 of every page is verified
+   * (Extended Read Memory command, e.g. DS28EC20). The DS2431 doesn't
+   * support it: `checkCrc` fails for the family 0x2D, and when
+   * `deviceAddress` is NULL the family can't be checked.
+   * The RMT backend reads OW_STREAM_CHUNK_BYTES (7 with one RX memory
+   * block) per round trip.
+   * Returns true on success.
+   */
+  bool readMemory(const uint8_t *deviceAddress, uint16_t memAddress,
+                  uint8_t *buf, uint16_t count, bool checkCrc = false);
+
+  /*
+   * Write the same alarm thresholds `high`/`low` (Deg. C) and `resolution`
+   * to all the devices at once: one Skip ROM Write Scratchpad and one Copy
+   * Scratchpad with strong pull-up. The EEPROMs are then recalled and
+   * verified over the devices table, and only the devices which didn't
+   * take the change are written one by one.
+   * Dallas::getResolution() is not updated, it would search the bus again
+   * for every device; the conversion waits use getMaxResolution().
+   * Returns the number of devices written one by one, -1 if no device
+   * answered.
+   */
+  int broadcastConfig(int8_t high, int8_t low, uint8_t resolution);
+
+  /*
+   * Highest resolution of the devices table, as seen by the last full read
+   * or broadcastConfig(). Devices not read yet count with
+   * Dallas::getResolution().
+   */
+  uint8_t getMaxResolution(void);
+
+  /*
+   * Set how requestTemperatures() waits for the conversion when
+   * getWaitForConversion() is true.
+   */
+  void setWaitStrategy(enum mgos_dallas_wait_strategy strategy);
+  enum mgos_dallas_wait_strategy getWaitStrategy() const;
+
+  /*
+   * Send the convert command to all the devices and, if
+   * getWaitForConversion() is true, wait with the configured strategy. With
+   * getCheckForConversion() and externally powered devices the wait ends
+   * when the devices answer the read slots.
+   * Dallas::requestTemperatures() is not virtual: this hides it, it doesn't
+   * override it. Calls through a `Dallas *`, e.g.
+   * mgos_dallas_request_temperatures(), still wait busily; call it through a
+   * `DallasESP32 *` (C: mgos_dallas_esp32_request_temperatures).
+   */
+  void requestTemperatures(void);
+
+  /*
+   * Same as requestTemperatures() for one device. Hide the methods of
+   * Dallas as well.
+   */
+  bool requestTemperaturesByAddress(const uint8_t *deviceAddress);
+  bool requestTemperaturesByIndex(uint8_t index);
+
+  /*
+   * Set how publishReadings() reads the temperatures.
+   * With `fullReadEvery` == 1 (default) the whole scratchpad is read and its
+   * CRC checked every time. Otherwise only the 2 temperature bytes are read
+   * and the full CRC checked read is done every `fullReadEvery` cycles
+   * (never if 0) or when the fast value looks implausible: 85.00 Deg.
+   * (power-on value) or a jump larger than `maxJump` centi-degrees from the
+   * last published value (`maxJump` <= 0 disables the check).
+   * The fast reads mask the temperature with the resolution of the device
+   * seen by its last full read; a device not read in full yet is read in
+   * full.
+   */
+  void setReadPolicy(uint16_t fullReadEvery, int32_t maxJump);
+
+  /*
+   * Set the sampling interval of the device `deviceAddress` for
+   * scheduleTick(), or the default one if `deviceAddress` is NULL.
+   * 0 (default) samples the device at every tick.
+   */
+  void setSampleInterval(const uint8_t *deviceAddress, uint32_t intervalMs);
+
+  /*
+   * Convert and read only the devices whose sampling interval elapsed:
+   * with one Skip ROM convert when most of them are due, with per ROM
+   * converts otherwise. Waits with the wait strategy, then publishes the
+   * snapshot, the other devices keep their last reading.
+   * Call it periodically, at the shortest sampling interval.
+   * Returns the number of devices read.
+   */
+  int scheduleTick();
+
+  /*
+   * Read the temperature of every device on the bus and publish them as the
+   * latest readings snapshot. Call it from the polling task only, after
+   * requestTemperatures().
+   * Returns the number of published readings.
+   */
+  int publishReadings();
+
+  /*
+   * Copy up to `max` readings of the latest snapshot into `out`.
+   * Without bus I/O or lock, from any task or core: the snapshot is double
+   * buffered and the reader never waits for the writer. It only copies
+   * again if a whole publish completed meanwhile.
+   * Returns the number of copied readings.
+   */
+  int getReadings(struct mgos_dallas_reading *out, int max) const;
+
+  /*
+   * Copy the latest reading of the device `deviceAddress` into `out`.
+   * Returns false if the device is not in the snapshot.
+   */
+  bool getReading(const uint8_t *deviceAddress,
+                  struct mgos_dallas_reading *out) const;
+
+  /*
+   * Configure the events triggered by publishReadings() for the device
+   * `deviceAddress`, values in centi-degrees C. See
+   * mgos_dallas_esp32_set_notify().
+   * The events are delivered on the mgos task, after the bus is released,
+   * so the handlers may use the bus and mJS handlers are safe. The
+   * DallasESP32 must outlive the delivery.
+   * If `deviceAddress` is NULL, `delta` becomes the default for the devices
+   * not configured.
+   * Returns false if the devices table is full.
+   */
+  bool setNotify(const uint8_t *deviceAddress, int32_t delta, int32_t low,
+                 int32_t high);
+
+ protected:
+  void publish(const struct mgos_dallas_reading *readings, int count);
+  bool readTemp(const uint8_t *rom, bool full, int32_t *temp);
+  bool readTempPolicy(const uint8_t *rom, int32_t *temp);
+  void readDevice(struct mgos_dallas_reading *r);
+  void waitConversion(bool poll, uint32_t epoch);
+  void waitFor(uint32_t ms);
+  void notify(const struct mgos_dallas_reading *readings, int count);
+
+ private:
+  struct Device {
+    uint8_t rom[8];
+    // from the configuration byte of the last full read, 0 if unknown
+    uint8_t resolution;
+  };
+
+  struct Snapshot {
+    int count;
+    struct mgos_dallas_reading readings[MGOS_DALLAS_ESP32_MAX_READINGS];
+  };
+
+  enum Zone { ZONE_LOW, ZONE_NORMAL, ZONE_HIGH };
+
+  struct Notify {
+    uint8_t rom[8];
+    int32_t delta;
+    int32_t low;
+    int32_t high;
+    int32_t lastTemp;
+    uint8_t zone;
+    bool present;
+    bool configured;
+  };
+
+  struct Schedule {
+    uint8_t rom[8];
+    uint32_t interval;
+    // mgos_uptime_micros() of the next sample
+    int64_t next;
+    bool configured;
+  };
+
+  Device *findDevice(const uint8_t *rom);
+  void verifySingle(void);
+  const Snapshot &published(void) const;
+  Schedule *findSchedule(const uint8_t *rom);
+
+  Notify *findNotify(const uint8_t *rom, bool create);
+  uint8_t zoneOf(const Notify *n, int32_t temp) const;
+  void trigger(int ev, const struct mgos_dallas_reading *reading,
+               int32_t prevTemp);
+  void deliverEvents(void);
+  static void eventCb(void *arg);
+
+  void init();
+
+  // same object as _ow
+  OnewireESP32Bus *_bus;
+  struct onewire_bus_lock *_busLock;
+  // devices found by refreshDevices()
+  Device _devices[MGOS_DALLAS_ESP32_MAX_READINGS];
+  int _deviceCount;
+  bool _devicesLoaded;
+  // mgos_uptime_micros() of the last search from the start
+  int64_t _singleVerified;
+
+  enum mgos_dallas_wait_strategy _waitStrategy;
+  uint16_t _fullReadEvery;
+  int32_t _maxJump;
+  uint32_t _cycle;
+
+  Schedule _schedule[MGOS_DALLAS_ESP32_MAX_READINGS];
+  int _scheduleCount;
+  uint32_t _defaultInterval;
+
+  Notify _notify[MGOS_DALLAS_ESP32_MAX_READINGS];
+  int _notifyCount;
+  // events of the last publish, delivered once the bus is released
+  struct PendingEvent {
+    int ev;
+    struct mgos_dallas_event_data data;
+  };
+  // at most one per reading plus one per lost device
+  PendingEvent _events[2 * MGOS_DALLAS_ESP32_MAX_READINGS];
+  int _eventCount;
+  int32_t _defaultDelta;
+
+  // number of publishes; _snapshots[_seq & 1] is the published one, the
+  // writer fills the other one
+  volatile uint32_t _seq;
+  Snapshot _snapshots[2];
 };
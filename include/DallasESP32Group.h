@@ -0,0 +1,55 @@
+#pragma once
+#include "DallasESP32.h"
+
+/*
+ * A group of 1-Wire buses, one per GPIO, sharing one RMT channel pair.
+ * Every bus is a DallasESP32 with its own search state, ROM table and
+ * readings snapshot. The RMT channels are switched between the pins through
+ * the GPIO matrix, so the buses are accessed one at a time.
+ */
+class DallasESP32Group {
+ public:
+  DallasESP32Group(const uint8_t *pins, uint8_t count, uint8_t rmt_rx,
+                   uint8_t rmt_tx);
+
+  ~DallasESP32Group();
+
+  /*
+   * Search the devices of every bus.
+   */
+  void begin(void);
+
+  uint8_t getBusCount(void) const;
+
+  /*
+   * Return the bus at `index` or NULL if out of range.
+   */
+  DallasESP32 *getBus(uint8_t index) const;
+
+  /*
+   * Return the number of devices found on all the buses.
+   */
+  int getDeviceCount(void);
+
+  /*
+   * Start the conversion on every bus, wait once for the longest conversion
+   * and publish the readings of every bus (see DallasESP32::publishReadings).
+   * Parasite powered buses need the strong pull-up for the whole conversion,
+   * so they are converted one after the other.
+   * Returns the number of published readings.
+   */
+  int sweep(void);
+
+  /*
+   * Round robin: convert and publish the readings of the next bus only,
+   * waiting with its wait strategy. Call it periodically to spread the bus
+   * activity over time.
+   * Returns the number of published readings.
+   */
+  int sweepNext(void);
+
+ private:
+  DallasESP32 **_buses;
+  uint8_t _count;
+  uint8_t _next;
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include "OnewireInterface.h"
+
+struct onewire_bus_lock;
+
+/*
+ * OnewireInterface of the ESP32 backends, with the operations DallasESP32
+ * needs beyond it. A new backend only has to implement this class.
+ */
+class OnewireESP32Bus : public OnewireInterface {
+ public:
+  /*
+   * Read a sequence of bytes like read_bytes(). Returns false on a bus
+   * error (driver error or timeout).
+   */
+  virtual bool readBytes(uint8_t *buf, uint16_t count) = 0;
+
+  /*
+   * Lock arbitrating the bus between tasks, see onewire_bus_lock.h. NULL if
+   * the bus failed to start.
+   */
+  virtual struct onewire_bus_lock *busLock() = 0;
+
+  /*
+   * Only device on the bus, selected with Skip ROM instead of MATCH ROM.
+   * NULL forgets it. getSingleDevice() returns false if it is not known,
+   * `rom` may be NULL.
+   */
+  virtual void setSingleDevice(const uint8_t *rom) = 0;
+  virtual bool getSingleDevice(uint8_t *rom) = 0;
+};
@@ -0,0 +1,370 @@
+#pragma once
+#include <mgos.h>
+
+#include "OnewireESP32Bus.h"
+#include "driver/gpio.h"
+#include "driver/rmt.h"
+#include "onewire_bus_lock.h"
+#include "onewire_rmt.h"
+
+/*
+ * Timing profiles for OnewireESP32T, all durations in us.
+ */
+struct OnewireTimingStandard {
+  // reset pulse low phase
+  static constexpr uint16_t reset = 480;
+  // window for the presence pulse after the reset pulse
+  static constexpr uint16_t presence = 60;
+  // overall slot duration
+  static constexpr uint16_t slot = 75;
+  // write 1 slot and read slot low phase
+  static constexpr uint16_t low1 = 2;
+  // write 0 slot low phase
+  static constexpr uint16_t low0 = 65;
+  // sample time for read slot
+  static constexpr uint16_t sample = 15 - 2;
+};
+
+// longer recovery and later sampling for long or heavily loaded lines
+struct OnewireTimingLongLine {
+  static constexpr uint16_t reset = 500;
+  static constexpr uint16_t presence = 70;
+  static constexpr uint16_t slot = 90;
+  static constexpr uint16_t low1 = 3;
+  static constexpr uint16_t low0 = 70;
+  static constexpr uint16_t sample = 15;
+};
+
+/*
+ * Compile-time specialized 1-Wire driver on the RMT channels `RmtRx` and
+ * `RmtTx` and the GPIO `Pin`.
+ * It implements OnewireESP32Bus, so DallasESP32 can use it (see
+ * DallasESP32(OnewireESP32Bus *)). The class is final: called through the
+ * concrete type, the methods are not dispatched virtually and the transfers
+ * are inlined. Every bus operation (reset, slots, search) is encoded with the
+ * `Timing` profile and sent directly to the RMT channels. The channels are
+ * attached to `Pin` at every reset and the RX idle threshold of the profile
+ * is restored after each transfer, so they can be shared with other buses.
+ */
+template <uint8_t Pin, uint8_t RmtRx, uint8_t RmtTx,
+          class Timing = OnewireTimingStandard>
+class OnewireESP32T final : public OnewireESP32Bus {
+  static_assert(Pin < 34, "Pin must be an output capable GPIO (0..33)");
+  static_assert(Pin != 20 && Pin != 24 && (Pin < 28 || Pin > 31),
+                "GPIO 20, 24 and 28..31 don't exist on the ESP32");
+  static_assert(Pin < 6 || Pin > 11, "GPIO 6..11 are used by the SPI flash");
+  static_assert(RmtRx < 8 && RmtTx < 8, "RMT channels are 0..7");
+  static_assert(RmtRx != RmtTx, "RX and TX need different RMT channels");
+  static_assert(Timing::low1 < Timing::sample &&
+                    Timing::sample < Timing::low0 &&
+                    Timing::low0 < Timing::slot,
+                "Timing must satisfy low1 < sample < low0 < slot");
+  static_assert(Timing::slot + 2 < Timing::reset,
+                "Slot longer than the reset pulse");
+
+ public:
+  OnewireESP32T() : _ow(onewire_rmt_create(Pin, RmtRx, RmtTx)), _rb(NULL) {
+    memset(&_sst, 0, sizeof(_sst));
+    if (_ow) {
+      rmt_get_ringbuf_handle((rmt_channel_t) RmtRx, &_rb);
+    }
+  }
+
+  virtual ~OnewireESP32T() {
+    if (_ow) {
+      onewire_rmt_close(_ow);
+    }
+  }
+
+  bool isValid() const {
+    return _ow != NULL;
+  }
+
+  virtual uint8_t reset(void) {
+    // a reset starts a new transaction, let a more urgent task use the bus;
+    // it may search this bus too, resume our search where it stopped
+    SearchState sst = _sst;
+    if (onewire_bus_lock_yield(onewire_rmt_bus_lock(_ow))) _sst = sst;
+    // the channels may have been routed to the pin of another bus
+    if (!onewire_rmt_attach(_ow)) return 0;
+
+    rmt_item32_t items[1];
+    items[0].level0 = 0;
+    items[0].duration0 = Timing::reset;
+    // zero duration: end marker
+    items[0].level1 = 1;
+    items[0].duration1 = 0;
+
+    bool presence = false;
+    size_t size;
+    rmt_item32_t *rx = transfer(items, 1, Timing::reset + Timing::presence,
+                                &size);
+    if (rx) {
+      // the pulse seen by RX is followed by the presence pulse
+      if (size >= 2 * sizeof(rmt_item32_t) && rx[0].level0 == 0 &&
+          rx[0].duration0 >= Timing::reset - 2 && rx[0].level1 == 1 &&
+          rx[0].duration1 > 0 && rx[1].level0 == 0) {
+        presence = true;
+      }
+      vRingbufferReturnItem(_rb, rx);
+    }
+    rmt_rx_stop((rmt_channel_t) RmtRx);
+    return presence;
+  }
+
+  virtual void select(const uint8_t rom[8]) {
+    uint8_t buf[9];
+    // Skip ROM for the only device of the bus, see onewire_rmt_set_single()
+    if (onewire_rmt_get_single(_ow, buf) && memcmp(buf, rom, 8) == 0) {
+      skip();
+      return;
+    }
+    buf[0] = 0x55;
+    memcpy(&buf[1], rom, 8);
+    write_bytes(buf, sizeof(buf), false);
+  }
+
+  virtual void skip(void) {
+    write(0xCC, 0);
+  }
+
+  virtual void write(uint8_t v, uint8_t power = 0) {
+    rmt_item32_t items[8 + 1];
+    encodeWrite(items, v, 8);
+    send(items, 8, power);
+  }
+
+  virtual void write_bytes(const uint8_t *buf, uint16_t count,
+                           bool power = false) {
+    // the TX driver refills the channel memory, so several bytes are sent
+    // per call
+    rmt_item32_t items[kWriteChunk * 8 + 1];
+    while (count > 0) {
+      uint16_t n = count < kWriteChunk ? count : kWriteChunk;
+      for (uint16_t i = 0; i < n; i++) {
+        encodeWrite(&items[i * 8], buf[i], 8);
+      }
+      send(items, n * 8, power && n == count);
+      buf += n;
+      count -= n;
+    }
+  }
+
+  virtual uint8_t read(void) {
+    uint8_t data = 0;
+    receive(&data, 8);
+    return data;
+  }
+
+  virtual void read_bytes(uint8_t *buf, uint16_t count) {
+    readBytes(buf, count);
+  }
+
+  virtual bool readBytes(uint8_t *buf, uint16_t count) {
+    // the read slots of a chunk and their RX items fit into one memory block
+    while (count > 0) {
+      uint16_t n = count < kReadChunk ? count : kReadChunk;
+      if (!receive(buf, n * 8)) return false;
+      buf += n;
+      count -= n;
+    }
+    return true;
+  }
+
+  virtual void write_bit(uint8_t v) {
+    rmt_item32_t items[1 + 1];
+    encodeWrite(items, v, 1);
+    send(items, 1, 0);
+  }
+
+  virtual uint8_t read_bit(void) {
+    uint8_t data = 0;
+    receive(&data, 1);
+    return data;
+  }
+
+  virtual void depower(void) {
+    GPIO.pin[Pin].pad_driver = 1;
+  }
+
+  virtual void reset_search() {
+    memset(&_sst, 0, sizeof(_sst));
+  }
+
+  virtual void target_search(uint8_t family_code) {
+    memset(&_sst, 0, sizeof(_sst));
+    _sst.rom[0] = family_code;
+    _sst.lastDiscrepancy = 64;
+  }
+
+  // Same search algorithm as onewire_rmt_next(), the bit and its complement
+  // are read in one RMT round trip.
+  virtual uint8_t search(uint8_t *newAddr, bool search_mode = true) {
+    (void) search_mode;
+    bool fromStart = _sst.lastDiscrepancy == 0 && !_sst.lastDevice;
+    uint8_t lastZero = 0;
+    uint8_t bitNumber = 1;
+    bool found = false;
+
+    if (_sst.lastDevice) {
+      reset_search();
+      return false;
+    }
+    if (!reset()) {
+      reset_search();
+      if (fromStart) onewire_rmt_set_single(_ow, NULL);
+      return false;
+    }
+    write(0xF0, 0);
+    for (; bitNumber <= 64; bitNumber++) {
+      uint8_t byte = (bitNumber - 1) / 8;
+      uint8_t mask = 1 << ((bitNumber - 1) % 8);
+      uint8_t bits = 0;
+      if (!receive(&bits, 2)) break;
+      uint8_t idBit = bits & 0x01, cmpBit = (bits >> 1) & 0x01;
+      uint8_t direction;
+
+      // no devices on 1-wire
+      if (idBit && cmpBit) break;
+      if (idBit != cmpBit) {
+        direction = idBit;
+      } else {
+        if (bitNumber < _sst.lastDiscrepancy) {
+          direction = (_sst.rom[byte] & mask) != 0;
+        } else {
+          direction = bitNumber == _sst.lastDiscrepancy;
+        }
+        if (direction == 0) lastZero = bitNumber;
+      }
+      if (direction) {
+        _sst.rom[byte] |= mask;
+      } else {
+        _sst.rom[byte] &= ~mask;
+      }
+      write_bit(direction);
+    }
+    if (bitNumber > 64 && _sst.rom[0] != 0) {
+      _sst.lastDiscrepancy = lastZero;
+      _sst.lastDevice = lastZero == 0;
+      memcpy(newAddr, _sst.rom, 8);
+      found = true;
+    } else {
+      reset_search();
+    }
+    // a search from the start tells whether the first device is the only one
+    if (fromStart) {
+      onewire_rmt_set_single(_ow, found && _sst.lastDevice ? newAddr : NULL);
+    }
+    return found;
+  }
+
+  virtual struct onewire_bus_lock *busLock() {
+    return _ow ? onewire_rmt_bus_lock(_ow) : NULL;
+  }
+
+  virtual void setSingleDevice(const uint8_t *rom) {
+    if (_ow) onewire_rmt_set_single(_ow, rom);
+  }
+
+  virtual bool getSingleDevice(uint8_t *rom) {
+    return _ow ? onewire_rmt_get_single(_ow, rom) : false;
+  }
+
+ private:
+  static constexpr uint16_t kWriteChunk = 16;
+  // bytes per read round trip: 8 RX items each, one item for the idle
+  // marker in a 64 items memory block
+  static constexpr uint16_t kReadChunk = 7;
+
+  struct SearchState {
+    uint8_t rom[8];
+    uint8_t lastDiscrepancy;
+    bool lastDevice;
+  };
+
+  static inline rmt_item32_t slot(uint16_t low) {
+    rmt_item32_t item;
+    item.level0 = 0;
+    item.duration0 = low;
+    item.level1 = 1;
+    item.duration1 = Timing::slot - low;
+    return item;
+  }
+
+  static inline void encodeWrite(rmt_item32_t *items, uint8_t data,
+                                 uint8_t num) {
+    for (uint8_t i = 0; i < num; i++, data >>= 1) {
+      items[i] = (data & 0x01) ? slot(Timing::low1) : slot(Timing::low0);
+    }
+  }
+
+  static inline void endMarker(rmt_item32_t *item) {
+    item->level0 = 1;
+    item->duration0 = 0;
+  }
+
+  inline void send(rmt_item32_t *items, int num, uint8_t power) {
+    // strong pull-up by the push-pull driver or open-drain
+    GPIO.pin[Pin].pad_driver = power ? 0 : 1;
+    endMarker(&items[num]);
+    rmt_write_items((rmt_channel_t) RmtTx, items, num + 1, true);
+  }
+
+  // Send `num` items (end marker included) and wait for the RX frame, with
+  // the RX idle threshold `idle`. The threshold of the shared channel is
+  // restored afterwards. The caller returns the frame and stops RX.
+  inline rmt_item32_t *transfer(rmt_item32_t *items, int num, uint16_t idle,
+                                size_t *size) {
+    uint16_t oldIdle;
+    void *p;
+    size_t n;
+
+    GPIO.pin[Pin].pad_driver = 1;
+    rmt_get_rx_idle_thresh((rmt_channel_t) RmtRx, &oldIdle);
+    rmt_set_rx_idle_thresh((rmt_channel_t) RmtRx, idle);
+    while ((p = xRingbufferReceive(_rb, &n, 0))) {
+      vRingbufferReturnItem(_rb, p);
+    }
+    rmt_rx_start((rmt_channel_t) RmtRx, true);
+    rmt_item32_t *rx = NULL;
+    if (rmt_write_items((rmt_channel_t) RmtTx, items, num, true) == ESP_OK) {
+      rx = (rmt_item32_t *) xRingbufferReceive(_rb, size,
+                                               100 / portTICK_PERIOD_MS);
+    }
+    rmt_set_rx_idle_thresh((rmt_channel_t) RmtRx, oldIdle);
+    return rx;
+  }
+
+  // read `num` (<= kReadChunk * 8) slots into `data`, LSB first
+  inline bool receive(uint8_t *data, uint16_t num) {
+    rmt_item32_t items[kReadChunk * 8 + 1];
+    size_t size;
+    bool ok = false;
+
+    for (uint16_t i = 0; i < num; i++) {
+      items[i] = slot(Timing::low1);
+    }
+    endMarker(&items[num]);
+    memset(data, 0, (num + 7) / 8);
+    rmt_item32_t *rx = transfer(items, num + 1, Timing::slot + 2, &size);
+    if (rx) {
+      if (size >= num * sizeof(rmt_item32_t)) {
+        for (uint16_t i = 0; i < num; i++) {
+          // rising edge before the sample time -> bit 1
+          if (rx[i].level1 == 1 && rx[i].level0 == 0 &&
+              rx[i].duration0 < Timing::sample) {
+            data[i / 8] |= 1 << (i % 8);
+          }
+        }
+        ok = true;
+      }
+      vRingbufferReturnItem(_rb, rx);
+    }
+    rmt_rx_stop((rmt_channel_t) RmtRx);
+    return ok;
+  }
+
+  struct mgos_rmt_onewire *_ow;
+  RingbufHandle_t _rb;
+  SearchState _sst;
+};
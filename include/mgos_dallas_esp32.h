@@ -1,11 +1,90 @@
 #pragma once
 
 #include "mgos_dallas_interface.h"
+#include "mgos_event.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Maximum number of readings kept in the published snapshot */
+#ifndef MGOS_DALLAS_ESP32_MAX_READINGS
+#define MGOS_DALLAS_ESP32_MAX_READINGS 32
+#endif
+
+enum mgos_dallas_reading_status {
+  MGOS_DALLAS_READING_OK = 0,
+  MGOS_DALLAS_READING_DISCONNECTED = 1,
+};
+
+/*
+ * One entry of the published readings snapshot.
+ */
+struct mgos_dallas_reading {
+  uint8_t rom[8];
+  /* temperature in centi-degrees C, e.g. 1234 is 12.34 Deg. */
+  int32_t temp;
+  /* mgos_uptime_micros() when the device was read */
+  int64_t timestamp;
+  /* one of enum mgos_dallas_reading_status */
+  uint8_t status;
+};
+
+#ifdef __cplusplus
+class DallasESP32Group;
+#else
+typedef struct DallasESP32Group DallasESP32Group;
+#endif
+
+/*
+ * 1-Wire backends
+ */
+enum mgos_dallas_backend {
+  /* two RMT channels per bus (default) */
+  MGOS_DALLAS_BACKEND_RMT = 0,
+  /* one UART per bus */
+  MGOS_DALLAS_BACKEND_UART = 1,
+};
+
+#define MGOS_DALLAS_ESP32_EV_BASE MGOS_EVENT_BASE('D', 'A', 'L')
+
+/*
+ * Events triggered by `mgos_dallas_esp32_publish_readings` and
+ * `mgos_dallas_esp32_schedule_tick`. They are delivered on the mgos task
+ * (mgos_invoke_cb) once the bus is released, the handlers may use the bus.
+ * Event data is a `struct mgos_dallas_event_data *`.
+ */
+enum mgos_dallas_esp32_event {
+  /* temperature moved by more than the configured delta */
+  MGOS_DALLAS_ESP32_EV_CHANGED = MGOS_DALLAS_ESP32_EV_BASE,
+  /* temperature crossed the low or the high threshold */
+  MGOS_DALLAS_ESP32_EV_THRESHOLD,
+  /* device disappeared from the bus */
+  MGOS_DALLAS_ESP32_EV_LOST,
+  /* device was seen for the first time or reappeared on the bus */
+  MGOS_DALLAS_ESP32_EV_FOUND,
+};
+
+/*
+ * How `mgos_dallas_esp32_request_temperatures` waits for the conversion
+ * when waitForConversion is set.
+ */
+enum mgos_dallas_wait_strategy {
+  /* wait busily (mgos_usleep) without holding the bus */
+  MGOS_DALLAS_WAIT_BUSY = 0,
+  /* block the calling task (vTaskDelay), other tasks run meanwhile */
+  MGOS_DALLAS_WAIT_DELAY = 1,
+  /* put the chip in light sleep until the conversion window ends */
+  MGOS_DALLAS_WAIT_LIGHT_SLEEP = 2,
+};
+
+struct mgos_dallas_event_data {
+  Dallas *dt;
+  struct mgos_dallas_reading reading;
+  /* last temperature notified for this device, centi-degrees C */
+  int32_t prev_temp;
+};
+
 /*
  * Initializes the Dallas driver with a GPIO `pin`
  * and the RMT channels `rmt_rx` and `rmt_tx`
@@ -13,6 +92,215 @@ extern "C" {
  */
 Dallas *mgos_dallas_create_esp32(uint8_t pin, uint8_t rmt_rx, uint8_t rmt_tx);
 
+/*
+ * Initializes the Dallas driver with a GPIO `pin` and the `backend`
+ * (enum mgos_dallas_backend):
+ * - MGOS_DALLAS_BACKEND_RMT: `ch_a` and `ch_b` are the RMT rx and tx channels
+ * - MGOS_DALLAS_BACKEND_UART: `ch_a` is the UART number (1 or 2),
+ *   `ch_b` is not used
+ * Return value: handle opaque pointer.
+ */
+Dallas *mgos_dallas_create_esp32_backend(uint8_t pin, int backend,
+                                         uint8_t ch_a, uint8_t ch_b);
+
+/*
+ * Reads `len` bytes of the memory of the device with the onewire address
+ * `addr` (8-byte buffer, NULL for a single device bus) starting at
+ * `mem_addr` into `buf`. If `check_crc` is true, the CRC16 of every page is
+ * verified (Extended Read Memory), not supported by the DS2431 (family 0x2D).
+ * The handle `dt` must be created with `mgos_dallas_create_esp32`.
+ * Return value: true in case of success, false otherwise.
+ */
+bool mgos_dallas_esp32_read_memory(Dallas *dt, const char *addr, int mem_addr,
+                                   char *buf, int len, bool check_crc);
+
+/*
+ * Creates a group of `count` buses on the GPIOs `pins`, all sharing the RMT
+ * channels `rmt_rx` and `rmt_tx`, and searches their devices.
+ * Return value: handle opaque pointer.
+ */
+DallasESP32Group *mgos_dallas_esp32_group_create(const uint8_t *pins,
+                                                 int count, uint8_t rmt_rx,
+                                                 uint8_t rmt_tx);
+void mgos_dallas_esp32_group_close(DallasESP32Group *group);
+
+/*
+ * Returns the number of buses of the group.
+ */
+int mgos_dallas_esp32_group_get_bus_count(DallasESP32Group *group);
+
+/*
+ * Returns the Dallas handle of the bus at `index`, NULL if out of range.
+ * The handle is owned by the group, don't close it.
+ */
+Dallas *mgos_dallas_esp32_group_get_bus(DallasESP32Group *group, int index);
+
+/*
+ * Converts all the buses with one common wait and publishes their readings.
+ * Return value: number of published readings.
+ */
+int mgos_dallas_esp32_group_sweep(DallasESP32Group *group);
+
+/*
+ * Converts and publishes the readings of the next bus (round robin).
+ * Return value: number of published readings.
+ */
+int mgos_dallas_esp32_group_sweep_next(DallasESP32Group *group);
+
+/*
+ * Writes the alarm thresholds `high`/`low` (Deg. C) and the `resolution` to
+ * all the devices with one broadcast write and one EEPROM copy, verifies
+ * them and writes one by one only the devices which didn't take the change.
+ * Return value: number of devices written one by one, -1 if no device
+ * answered.
+ */
+int mgos_dallas_esp32_broadcast_config(Dallas *dt, int high, int low,
+                                       int resolution);
+
+/*
+ * Sets the strategy used to wait for the conversion, one of
+ * enum mgos_dallas_wait_strategy.
+ */
+void mgos_dallas_esp32_set_wait_strategy(Dallas *dt, int strategy);
+
+/*
+ * Same as `mgos_dallas_request_temperatures`, but waits for the conversion
+ * with the configured wait strategy and, with the check for conversion flag
+ * set, polls the devices. `mgos_dallas_request_temperatures` calls the
+ * hidden `Dallas::requestTemperatures` and always waits busily.
+ */
+void mgos_dallas_esp32_request_temperatures(Dallas *dt);
+
+/*
+ * Same as `mgos_dallas_request_temperatures_by_address` and
+ * `mgos_dallas_request_temperatures_by_index`, with the wait of
+ * `mgos_dallas_esp32_request_temperatures`.
+ */
+bool mgos_dallas_esp32_request_temperatures_by_address(Dallas *dt,
+                                                       const char *addr);
+bool mgos_dallas_esp32_request_temperatures_by_index(Dallas *dt, int index);
+
+/*
+ * Sets how `mgos_dallas_esp32_publish_readings` reads the temperatures:
+ * `full_read_every` == 1 (default) reads the whole scratchpad with CRC check
+ * every time, otherwise only the 2 temperature bytes are read, with a full
+ * read every `full_read_every` cycles (never if 0) or when the value looks
+ * implausible (85.00 Deg. or a jump larger than `max_jump` centi-degrees).
+ */
+void mgos_dallas_esp32_set_read_policy(Dallas *dt, int full_read_every,
+                                       int max_jump);
+
+/*
+ * Sets the sampling interval in ms of the device with the onewire address
+ * `addr` (8-byte buffer), or the default one if `addr` is NULL, used by
+ * `mgos_dallas_esp32_schedule_tick`. 0 samples at every tick.
+ */
+void mgos_dallas_esp32_set_sample_interval(Dallas *dt, const char *addr,
+                                           int interval_ms);
+
+/*
+ * Converts and reads only the devices whose sampling interval elapsed and
+ * publishes the snapshot. Call it periodically, at the shortest interval.
+ * Return value: number of devices read.
+ */
+int mgos_dallas_esp32_schedule_tick(Dallas *dt);
+
+/*
+ * Reads all the devices on the bus and publishes the readings snapshot.
+ * Call it from the polling task after `mgos_dallas_request_temperatures`.
+ * Return value: number of published readings.
+ */
+int mgos_dallas_esp32_publish_readings(Dallas *dt);
+
+/*
+ * Configures the events of the device with the onewire address `addr`
+ * (8-byte buffer). All the values are in centi-degrees C.
+ * MGOS_DALLAS_ESP32_EV_CHANGED is triggered when the temperature moves by
+ * more than `delta` since the last notification (`delta` <= 0 disables it).
+ * MGOS_DALLAS_ESP32_EV_THRESHOLD is triggered when the temperature crosses
+ * `low` or `high` (disabled if `low` >= `high`).
+ * If `addr` is NULL, `delta` is the default for the devices not configured.
+ * Return value: false if the devices table is full.
+ */
+bool mgos_dallas_esp32_set_notify(Dallas *dt, const char *addr, int delta,
+                                  int low, int high);
+
+/*
+ * Copies up to `max` readings of the latest published snapshot into `out`.
+ * Without lock or bus I/O and without waiting for the writer (double
+ * buffered snapshot), can be called from any task or core.
+ * Return value: number of copied readings.
+ */
+int mgos_dallas_esp32_get_readings(Dallas *dt, struct mgos_dallas_reading *out,
+                                   int max);
+
+/*
+ * Copies the latest published reading of the device with the onewire address
+ * `addr` (8-byte buffer) into `out`.
+ * Return value: true if the device is in the snapshot, false otherwise.
+ */
+bool mgos_dallas_esp32_get_reading(Dallas *dt, const char *addr,
+                                   struct mgos_dallas_reading *out);
+
+/*
+ * Returns the latest published temperature of the device with the onewire
+ * address `addr` in centi-degrees C, or DEVICE_DISCONNECTED_C * 100 if the
+ * device is not in the snapshot or disconnected.
+ */
+int mgos_dallas_esp32_get_snapshot_tempc(Dallas *dt, const char *addr);
+
+/*
+ * Same as `mgos_dallas_begin`, with the bus locked against the other tasks.
+ */
+void mgos_dallas_esp32_begin(Dallas *dt);
+
+/*
+ * Takes the bus for a sequence of `mgos_dallas_*` calls when other tasks use
+ * it, with the FreeRTOS `priority` (-1: priority of the calling task). The
+ * owner yields the bus to a waiting task with a higher priority between two
+ * 1-Wire transactions. The `mgos_dallas_esp32_*` functions lock the bus
+ * themselves. Calls can be nested, every lock needs an unlock.
+ */
+void mgos_dallas_esp32_lock_bus(Dallas *dt, int priority);
+void mgos_dallas_esp32_unlock_bus(Dallas *dt);
+
+/*
+ * Converts and reads the temperature of the device with the onewire address
+ * `addr` only, e.g. from a control loop task. With a higher priority than the
+ * task scanning the bus, it runs between two devices of the scan.
+ * Return value: temperature in centi-degrees C, or DEVICE_DISCONNECTED_C * 100
+ * if the device didn't answer.
+ */
+int mgos_dallas_esp32_read_temperature(Dallas *dt, const char *addr);
+
+/*
+ * A bus found with exactly one device by a search addresses it with Skip ROM
+ * instead of MATCH ROM, searched again by `mgos_dallas_esp32_publish_readings`,
+ * `mgos_dallas_esp32_schedule_tick`, `mgos_dallas_esp32_request_temperatures*`
+ * and `mgos_dallas_esp32_read_temperature` every OW_SKIP_ROM_VERIFY_MS; its
+ * temperatures are read with the CRC check meanwhile.
+ * Sets the only device of the bus `addr` (8-byte buffer) known in advance,
+ * e.g. persisted from `mgos_dallas_esp32_get_single_device`, NULL to forget
+ * it.
+ */
+void mgos_dallas_esp32_set_single_device(Dallas *dt, const char *addr);
+
+/*
+ * Copies the address of the only device of the bus into `addr` (8-byte
+ * buffer).
+ * Return value: false if the bus is not known to have only one device.
+ */
+bool mgos_dallas_esp32_get_single_device(Dallas *dt, char *addr);
+
+/*
+ * Accessors of `struct mgos_dallas_event_data` for mJS.
+ */
+int mgos_dallas_esp32_ev_get_tempc(const struct mgos_dallas_event_data *ev);
+int mgos_dallas_esp32_ev_get_prev_tempc(
+    const struct mgos_dallas_event_data *ev);
+void mgos_dallas_esp32_ev_get_address(const struct mgos_dallas_event_data *ev,
+                                      char *addr);
+
 #ifdef __cplusplus
 }
 #endif
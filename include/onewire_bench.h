@@ -0,0 +1,37 @@
+#pragma once
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * On-target measurement of the per-byte cost of OnewireESP32 called through
+ * OnewireInterface (virtual dispatch, as used by Dallas) and of
+ * OnewireESP32T (inlined), and of the UART backend OnewireESP32Uart through
+ * OnewireInterface, built with OW_BENCH. All run on the GPIO OW_BENCH_PIN,
+ * the RMT drivers with the channels OW_BENCH_RMT_RX and OW_BENCH_RMT_TX, the
+ * UART driver with the UART OW_BENCH_UART.
+ * The bus should be idle or have only devices which ignore the slots after
+ * a Skip ROM without a function command.
+ */
+struct onewire_bench_result {
+  int virt_write_us;
+  int virt_read_us;
+  int tmpl_write_us;
+  int tmpl_read_us;
+  int uart_write_us;
+  int uart_read_us;
+};
+
+/*
+ * Write and read `bytes` bytes with the three drivers and store the mean
+ * duration per byte in `res`. Every byte is one driver round trip; its 8
+ * slots take 8 * 75 = 600us with RMT, 8 * 10 bits at 115200 baud = 694us with
+ * the UART. The rest is the round trip overhead of the driver.
+ */
+bool onewire_bench_run(int bytes, struct onewire_bench_result *res);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Transaction level arbitration of a 1-Wire bus between tasks.
+ * The lock is recursive and, when released, handed over to the waiting
+ * task with the highest priority. The owner yields the bus to a waiter with
+ * a higher priority at every reset, i.e. between two 1-Wire transactions,
+ * and takes it back afterwards.
+ * All the functions accept a NULL lock and do nothing.
+ */
+
+/* maximum number of tasks waiting for the bus */
+#ifndef OW_BUS_LOCK_MAX_WAITERS
+#define OW_BUS_LOCK_MAX_WAITERS 8
+#endif
+
+/* use the FreeRTOS priority of the calling task */
+#define OW_BUS_LOCK_TASK_PRIO (-1)
+
+struct onewire_bus_lock *onewire_bus_lock_create(void);
+void onewire_bus_lock_delete(struct onewire_bus_lock *l);
+
+/*
+ * Take the bus with the priority `prio` (higher is more urgent), blocks
+ * until it is available. Waiters with the same priority get the bus in
+ * the order they asked for it.
+ */
+void onewire_bus_lock_take(struct onewire_bus_lock *l, int prio);
+void onewire_bus_lock_give(struct onewire_bus_lock *l);
+
+/*
+ * If the calling task owns the bus and a task with a higher priority waits
+ * for it, hand the bus over and block until it is given back.
+ * Returns true if the bus was handed over: the state of the bus (search
+ * position, selected device) may have changed meanwhile.
+ */
+bool onewire_bus_lock_yield(struct onewire_bus_lock *l);
+
+/*
+ * Number of times the bus was taken by a task other than its previous
+ * owner. While it doesn't change, no other task addressed the devices of the
+ * bus, e.g. a device still answers the read slots after its Convert T.
+ * Returns 0 for a NULL lock.
+ */
+uint32_t onewire_bus_lock_epoch(struct onewire_bus_lock *l);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compute the 1-Wire CRC16 of `len` bytes, starting from `crc`.
+ * Devices send the inverted CRC16, compare with ~crc.
+ */
+uint16_t onewire_crc16(uint16_t crc, const uint8_t *data, int len);
+
+#ifdef __cplusplus
+}
+#endif
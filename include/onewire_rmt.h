@@ -0,0 +1,74 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Create a bus on `pin`. Several buses on different pins may share the same
+ * RMT channel pair, which is switched between their pins through the GPIO
+ * matrix. The channels are uninstalled when the last bus is closed.
+ */
+struct mgos_rmt_onewire *onewire_rmt_create(int pin, int rmt_rx, int rmt_tx);
+void onewire_rmt_close(struct mgos_rmt_onewire *ow);
+
+/*
+ * Attach the RMT channels to the pin of `ow`, if not already attached.
+ * Every reset does it, it is needed only by code accessing the channels
+ * directly.
+ */
+bool onewire_rmt_attach(struct mgos_rmt_onewire *ow);
+
+/*
+ * Lock arbitrating the RMT channels between tasks, shared by all the buses,
+ * see onewire_bus_lock.h. Every reset is a point where the owner yields.
+ */
+struct onewire_bus_lock *onewire_rmt_bus_lock(struct mgos_rmt_onewire *ow);
+
+bool onewire_rmt_reset(struct mgos_rmt_onewire *ow);
+/*
+uint8_t onewire_rmt_crc8(const uint8_t *rom, int len);
+ */
+void onewire_rmt_target_setup(struct mgos_rmt_onewire *ow,
+                              const uint8_t family_code);
+
+bool onewire_rmt_next(struct mgos_rmt_onewire *ow, uint8_t *rom, int mode);
+void onewire_rmt_select(struct mgos_rmt_onewire *ow, const uint8_t *rom);
+void onewire_rmt_skip(struct mgos_rmt_onewire *ow);
+void onewire_rmt_search_clean(struct mgos_rmt_onewire *ow);
+
+/*
+ * When a search from the start finds exactly one device, onewire_rmt_select()
+ * of that device sends Skip ROM instead of MATCH ROM, until a search from the
+ * start finds another device. The bus is not searched on its own, see
+ * DallasESP32::setSingleDevice().
+ * Set the only device `rom` known in advance (e.g. persisted), NULL to
+ * forget it. Get it into `rom`, returns false if not known.
+ */
+void onewire_rmt_set_single(struct mgos_rmt_onewire *ow, const uint8_t *rom);
+bool onewire_rmt_get_single(struct mgos_rmt_onewire *ow, uint8_t *rom);
+
+bool onewire_rmt_read_bit(struct mgos_rmt_onewire *ow);
+uint8_t onewire_rmt_read(struct mgos_rmt_onewire *ow);
+/*
+ * Read `len` bytes, returns false on a bus error.
+ */
+bool onewire_rmt_read_bytes(struct mgos_rmt_onewire *ow, uint8_t *buf, int len);
+
+void onewire_rmt_write_bit(struct mgos_rmt_onewire *ow, int bit);
+void onewire_rmt_write(struct mgos_rmt_onewire *ow, const uint8_t data);
+/*
+ * Write a byte, if `power` is true the bus is left strongly pulled up
+ * (push-pull driver) until onewire_rmt_depower() or the next transfer.
+ */
+void onewire_rmt_write_power(struct mgos_rmt_onewire *ow, const uint8_t data,
+                             bool power);
+void onewire_rmt_depower(struct mgos_rmt_onewire *ow);
+void onewire_rmt_write_bytes(struct mgos_rmt_onewire *ow, const uint8_t *buf,
+                             int len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Raw waveform trace of the RMT TX and RX items, compiled in only if
+ * OW_TRACE is defined. The items are copied into a fixed ring buffer of
+ * OW_TRACE_RECORDS records, the oldest ones are overwritten.
+ */
+
+#ifndef OW_TRACE_RECORDS
+#define OW_TRACE_RECORDS 1024
+#endif
+
+#define OW_TRACE_MAGIC "OWTR"
+#define OW_TRACE_VERSION 1
+
+enum onewire_rmt_trace_type {
+  OW_TRACE_TX = 0,
+  OW_TRACE_RX = 1,
+};
+
+/*
+ * One RMT item of a frame. All the items of a frame have the same time.
+ */
+struct onewire_rmt_trace_record {
+  /* low 32 bits of esp_timer_get_time() at the start of the frame [us] */
+  uint32_t time;
+  /* enum onewire_rmt_trace_type */
+  uint8_t type;
+  uint8_t gpio;
+  /* index of the item in the frame */
+  uint16_t index;
+  /* rmt_item32_t.val, durations in us */
+  uint32_t item;
+};
+
+/*
+ * Header of the dump file, followed by `count` records, oldest first.
+ * All the values are little endian.
+ */
+struct onewire_rmt_trace_header {
+  char magic[4];
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+#ifdef OW_TRACE
+
+void onewire_rmt_trace_enable(bool enable);
+void onewire_rmt_trace_clear(void);
+
+/*
+ * Write the trace to the file `path`. The ring is copied first, the tracing
+ * of the other tasks goes on during the file write.
+ * Returns the number of records written or -1 on error.
+ */
+int onewire_rmt_trace_dump(const char *path);
+
+/*
+ * Record a frame of `num` RMT items (`items` points to rmt_item32_t).
+ */
+void onewire_rmt_trace_frame(uint8_t type, uint8_t gpio, uint32_t time,
+                             const void *items, int num);
+uint32_t onewire_rmt_trace_time(void);
+
+#else
+
+static inline void onewire_rmt_trace_frame(uint8_t type, uint8_t gpio,
+                                           uint32_t time, const void *items,
+                                           int num) {
+  (void) type;
+  (void) gpio;
+  (void) time;
+  (void) items;
+  (void) num;
+}
+
+static inline uint32_t onewire_rmt_trace_time(void) {
+  return 0;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
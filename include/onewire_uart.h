@@ -0,0 +1,62 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 1-Wire backend generating the time slots with an ESP32 UART: one UART
+ * byte per slot at 115200 baud, 9600 baud for the reset. TX (open-drain)
+ * and RX are routed to the same `pin` through the GPIO matrix and a whole
+ * multi-byte transfer is queued into the FIFO at once.
+ * The UART `uart_num` must not be used by anything else.
+ */
+struct mgos_uart_onewire *onewire_uart_create(int pin, int uart_num);
+void onewire_uart_close(struct mgos_uart_onewire *ow);
+
+/*
+ * Lock arbitrating the bus between tasks, see onewire_bus_lock.h. Every reset
+ * is a point where the owner yields.
+ */
+struct onewire_bus_lock *onewire_uart_bus_lock(struct mgos_uart_onewire *ow);
+
+bool onewire_uart_reset(struct mgos_uart_onewire *ow);
+void onewire_uart_target_setup(struct mgos_uart_onewire *ow,
+                               const uint8_t family_code);
+
+bool onewire_uart_next(struct mgos_uart_onewire *ow, uint8_t *rom, int mode);
+void onewire_uart_select(struct mgos_uart_onewire *ow, const uint8_t *rom);
+void onewire_uart_skip(struct mgos_uart_onewire *ow);
+void onewire_uart_search_clean(struct mgos_uart_onewire *ow);
+
+/*
+ * Skip ROM for the only device of the bus, see onewire_rmt_set_single().
+ */
+void onewire_uart_set_single(struct mgos_uart_onewire *ow, const uint8_t *rom);
+bool onewire_uart_get_single(struct mgos_uart_onewire *ow, uint8_t *rom);
+
+bool onewire_uart_read_bit(struct mgos_uart_onewire *ow);
+uint8_t onewire_uart_read(struct mgos_uart_onewire *ow);
+/*
+ * Read `len` bytes, returns false on a bus error.
+ */
+bool onewire_uart_read_bytes(struct mgos_uart_onewire *ow, uint8_t *buf,
+                             int len);
+
+void onewire_uart_write_bit(struct mgos_uart_onewire *ow, int bit);
+void onewire_uart_write(struct mgos_uart_onewire *ow, const uint8_t data);
+/*
+ * Write a byte, if `power` is true the bus is left strongly pulled up
+ * (push-pull driver) until onewire_uart_depower() or the next transfer.
+ */
+void onewire_uart_write_power(struct mgos_uart_onewire *ow, const uint8_t data,
+                              bool power);
+void onewire_uart_depower(struct mgos_uart_onewire *ow);
+void onewire_uart_write_bytes(struct mgos_uart_onewire *ow, const uint8_t *buf,
+                              int len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,3 +1,4 @@
+load('api_events.js');
 
 let DallasESP32 = {
     // Error codes
@@ -5,9 +6,28 @@ let DallasESP32 = {
     DEVICE_DISCONNECTED_F: -196.6,
     DEVICE_DISCONNECTED_RAW: -7040,
 
+    // 1-Wire backends, see `DallasESP32.createWithBackend()`
+    BACKEND_RMT: 0,
+    BACKEND_UART: 1,
+
+    // Wait strategies, see `myDT.setWaitStrategy()`
+    WAIT_BUSY: 0,
+    WAIT_DELAY: 1,
+    WAIT_LIGHT_SLEEP: 2,
+
+    // Events triggered by `myDT.publishReadings()`, to be used with
+    // `Event.addHandler()`, delivered on the mgos task. Use `DallasESP32.evAddress(evdata)`,
+    // `DallasESP32.evTempC(evdata)` and `DallasESP32.evPrevTempC(evdata)`
+    // to get the event payload.
+    EV_CHANGED: Event.baseNumber('DAL'),
+    EV_THRESHOLD: Event.baseNumber('DAL') + 1,
+    EV_LOST: Event.baseNumber('DAL') + 2,
+    EV_FOUND: Event.baseNumber('DAL') + 3,
+
     _create: ffi('void* mgos_dallas_create_esp32(int, int, int)'),
+    _createb: ffi('void* mgos_dallas_create_esp32_backend(int, int, int, int)'),
     _close: ffi('void mgos_dallas_close(void *)'),
-    _begin: ffi('void mgos_dallas_begin(void *)'),
+    _begin: ffi('void mgos_dallas_esp32_begin(void *)'),
     _gdc: ffi('int mgos_dallas_get_device_count(void *)'),
     _va: ffi('int mgos_dallas_valid_address(void *, char *)'),
     _vf: ffi('int mgos_dallas_valid_family(void *, char *)'),
@@ -25,9 +45,11 @@ let DallasESP32 = {
     _gwfc: ffi('int mgos_dallas_get_wait_for_conversion(void *)'),
     _scfc: ffi('void mgos_dallas_set_check_for_conversion(void *, int)'),
     _gcfc: ffi('int mgos_dallas_get_check_for_conversion(void *)'),
-    _rts: ffi('void mgos_dallas_request_temperatures(void *)'),
-    _rtsba: ffi('int mgos_dallas_request_temperatures_by_address(void *, char *)'),
-    _rtsbi: ffi('int mgos_dallas_request_temperatures_by_index(void *, int)'),
+    _rts: ffi('void mgos_dallas_esp32_request_temperatures(void *)'),
+    _bc: ffi('int mgos_dallas_esp32_broadcast_config(void *, int, int, int)'),
+    _sws: ffi('void mgos_dallas_esp32_set_wait_strategy(void *, int)'),
+    _rtsba: ffi('int mgos_dallas_esp32_request_temperatures_by_address(void *, char *)'),
+    _rtsbi: ffi('int mgos_dallas_esp32_request_temperatures_by_index(void *, int)'),
     _gt: ffi('int mgos_dallas_get_temp(void *, char *)'),
     _gtc: ffi('int mgos_dallas_get_tempc(void *, char *)'),
     _gtf: ffi('int mgos_dallas_get_tempf(void *, char *)'),
@@ -36,12 +58,46 @@ let DallasESP32 = {
     _isppm: ffi('int mgos_dallas_is_parasite_power_mode(void *)'),
     _iscc: ffi('int mgos_dallas_is_conversion_complete(void *)'),
     _mtwfc: ffi('int mgos_dallas_millis_to_wait_for_conversion(void *, int)'),
+    _srp: ffi('void mgos_dallas_esp32_set_read_policy(void *, int, int)'),
+    _ssi: ffi('void mgos_dallas_esp32_set_sample_interval(void *, char *, int)'),
+    _st: ffi('int mgos_dallas_esp32_schedule_tick(void *)'),
+    _pr: ffi('int mgos_dallas_esp32_publish_readings(void *)'),
+    _gstc: ffi('int mgos_dallas_esp32_get_snapshot_tempc(void *, char *)'),
+    _rtc: ffi('int mgos_dallas_esp32_read_temperature(void *, char *)'),
+    _ssd: ffi('void mgos_dallas_esp32_set_single_device(void *, char *)'),
+    _gsd: ffi('int mgos_dallas_esp32_get_single_device(void *, char *)'),
+    _sn: ffi('int mgos_dallas_esp32_set_notify(void *, char *, int, int, int)'),
+    _evtc: ffi('int mgos_dallas_esp32_ev_get_tempc(void *)'),
+    _evptc: ffi('int mgos_dallas_esp32_ev_get_prev_tempc(void *)'),
+    _evga: ffi('void mgos_dallas_esp32_ev_get_address(void *, char *)'),
+    _rm: ffi('int mgos_dallas_esp32_read_memory(void *, char *, int, char *, int, int)'),
 
     _byte2hex: function (byte) {
         let hex_char = '0123456789abcdef';
         return hex_char[(byte >> 4) & 0x0F] + hex_char[byte & 0x0F];
     },
 
+    // ## **`DallasESP32.evAddress(evdata)`**
+    // Return the onewire address (8-byte string) of the device of an event.
+    evAddress: function (evdata) {
+        let addr = '        ';
+        DallasESP32._evga(evdata, addr);
+        return addr;
+    },
+
+    // ## **`DallasESP32.evTempC(evdata)`**
+    // Return the temperature in degrees C of the device of an event.
+    evTempC: function (evdata) {
+        return DallasESP32._evtc(evdata) / 100.0;
+    },
+
+    // ## **`DallasESP32.evPrevTempC(evdata)`**
+    // Return the previously notified temperature in degrees C of the device
+    // of an event.
+    evPrevTempC: function (evdata) {
+        return DallasESP32._evptc(evdata) / 100.0;
+    },
+
     // ## **`DallasESP32.create(pin, rmt_rx, rmt_tx)`**
     // Create and return an instance of the dallas temperature: an object with
     // methods described below.
@@ -62,6 +118,22 @@ let DallasESP32 = {
         return obj;
     },
 
+    // ## **`DallasESP32.createWithBackend(pin, backend, chA, chB)`**
+    // Like `DallasESP32.create()` with the choice of the 1-Wire backend:
+    // `DallasESP32.BACKEND_RMT` (`chA`, `chB` are the RMT rx and tx channels)
+    // or `DallasESP32.BACKEND_UART` (`chA` is the UART number, `chB` unused).
+    //
+    // Example:
+    // ```javascript
+    // let myDT = DallasESP32.createWithBackend(12, DallasESP32.BACKEND_UART, 2, 0);
+    // ```
+    createWithBackend: function (pin, backend, chA, chB) {
+        let obj = Object.create(DallasESP32._proto);
+        obj.dt = DallasESP32._createb(pin, backend, chA, chB);
+        DallasESP32._begin(obj.dt);
+        return obj;
+    },
+
     _proto: {
         // ## **`myDT.close()`**
         // Close DallasESP32 handle. Return value: none.
@@ -244,9 +316,30 @@ let DallasESP32 = {
             return DallasESP32._gcfc(this.dt);
         },
 
+        // ## **`myDT.broadcastConfig(high, low, res)`**
+        // Write the alarm thresholds `high`/`low` (degrees C) and the
+        // resolution `res` (9..12) to all the devices at once, verify them
+        // and write one by one only the devices which didn't take the change.
+        // Return the number of devices written one by one, -1 on failure.
+        broadcastConfig: function (high, low, res) {
+            return DallasESP32._bc(this.dt, high, low, res);
+        },
+
+        // ## **`myDT.setWaitStrategy(strategy)`**
+        // Set how `requestTemperatures()` waits for the conversion when the
+        // waitForConversion flag is set: `DallasESP32.WAIT_BUSY` (default,
+        // busy wait without holding the bus),
+        // `DallasESP32.WAIT_DELAY` (block the task) or
+        // `DallasESP32.WAIT_LIGHT_SLEEP` (light sleep until the end of the
+        // conversion).
+        // Return value: none.
+        setWaitStrategy: function (strategy) {
+            return DallasESP32._sws(this.dt, strategy);
+        },
+
         // ## **`myDT.requestTemperatures()`**
         // Send command for all devices on the bus to perform a temperature
-        // conversion.
+        // conversion. Waits with the strategy of `myDT.setWaitStrategy()`.
         //
         // Return value: 1 in case of success, 0 otherwise.
         requestTemperatures: function () {
@@ -332,6 +425,106 @@ let DallasESP32 = {
             return DallasESP32._mtwfc(this.dt, res);
         },
 
+        // ## **`myDT.setReadPolicy(fullReadEvery, maxJump)`**
+        // Set how `publishReadings()` reads the temperatures. With
+        // `fullReadEvery` = 1 (default) the whole scratchpad is read every
+        // time, otherwise only the temperature bytes, with a full CRC checked
+        // read every `fullReadEvery` cycles (never if 0) or when the value is
+        // 85.00 or jumps by more than `maxJump` degrees C.
+        // Return value: none.
+        setReadPolicy: function (fullReadEvery, maxJump) {
+            return DallasESP32._srp(this.dt, fullReadEvery, maxJump * 100);
+        },
+
+        // ## **`myDT.setSampleInterval(addr, ms)`**
+        // Set the sampling interval in ms of the device with the onewire
+        // address `addr` (8-byte string, or null for the default interval).
+        // Return value: none.
+        setSampleInterval: function (addr, ms) {
+            return DallasESP32._ssi(this.dt, addr, ms);
+        },
+
+        // ## **`myDT.scheduleTick()`**
+        // Convert and read only the devices whose sampling interval elapsed
+        // and publish the readings. Call it periodically, at the shortest
+        // sampling interval.
+        // Return value: number of devices read.
+        scheduleTick: function () {
+            return DallasESP32._st(this.dt);
+        },
+
+        // ## **`myDT.publishReadings()`**
+        // Read all the devices and publish the latest readings snapshot.
+        // Call it after `myDT.requestTemperatures()`.
+        // Return value: number of published readings.
+        publishReadings: function () {
+            return DallasESP32._pr(this.dt);
+        },
+
+        // ## **`myDT.getSnapshotTempC(addr)`**
+        // Return the latest published temperature of the device with the
+        // onewire address `addr` (8-byte string) in degrees C, without bus I/O,
+        // or `DallasESP32.DEVICE_DISCONNECTED_C` if it is not available.
+        getSnapshotTempC: function (addr) {
+            // C-functions output value of “1234” equals 12.34 Deg.
+            return DallasESP32._gstc(this.dt, addr) / 100.0;
+        },
+
+        // ## **`myDT.readTemperatureC(addr)`**
+        // Convert and read the temperature of the device with the onewire
+        // address `addr` (8-byte string) only, with the bus arbitrated against
+        // the other tasks. Return the temperature in degrees C or
+        // `DallasESP32.DEVICE_DISCONNECTED_C` in case of a failure.
+        readTemperatureC: function (addr) {
+            // C-functions output value of “1234” equals 12.34 Deg.
+            return DallasESP32._rtc(this.dt, addr) / 100.0;
+        },
+
+        // ## **`myDT.setSingleDevice(addr)`**
+        // Set the only device of the bus, addressed with Skip ROM, known in
+        // advance: onewire address `addr` (8-byte string), null to forget it.
+        // A search finding exactly one device sets it as well.
+        // Return value: none.
+        setSingleDevice: function (addr) {
+            return DallasESP32._ssd(this.dt, addr);
+        },
+
+        // ## **`myDT.getSingleDevice(addr)`**
+        // Write the onewire address of the only device of the bus into the
+        // string buffer `addr` (8 bytes).
+        // Return value: 1 if the bus is known to have only one device, 0
+        // otherwise.
+        getSingleDevice: function (addr) {
+            return DallasESP32._gsd(this.dt, addr);
+        },
+
+        // ## **`myDT.setNotify(addr, delta, low, high)`**
+        // Configure the events of the device with the onewire address `addr`
+        // (8-byte string, or null to set the default `delta`), values in
+        // degrees C. `EV_CHANGED` is triggered when the temperature moves by
+        // more than `delta`, `EV_THRESHOLD` when it crosses `low` or `high`.
+        // Return value: 1 in case of success, 0 otherwise.
+        // Example:
+        // ```javascript
+        // myDT.setNotify(null, 0.5, 0, 0);
+        // Event.addHandler(DallasESP32.EV_CHANGED, function(ev, evdata, ud) {
+        //   print(myDT.toHexStr(DallasESP32.evAddress(evdata)), DallasESP32.evTempC(evdata));
+        // }, null);
+        // ```
+        setNotify: function (addr, delta, low, high) {
+            return DallasESP32._sn(this.dt, addr, delta * 100, low * 100, high * 100);
+        },
+
+        // ## **`myDT.readMemory(addr, memAddr, buf, checkCrc)`**
+        // Read `buf.length` bytes of the memory of the device with the onewire
+        // address `addr` (8-byte string) starting at `memAddr` into the string
+        // buffer `buf`. If `checkCrc` is true, the CRC16 of every page is
+        // verified (not supported by the DS2431).
+        // Return value: 1 in case of success, 0 otherwise.
+        readMemory: function (addr, memAddr, buf, checkCrc) {
+            return DallasESP32._rm(this.dt, addr, memAddr, buf, buf.length, checkCrc);
+        },
+
         // ## **`myDT.toHexStr(addr)`**
         // Return device address `addr` in the hex format.
         toHexStr: function (addr) {
@@ -1,11 +1,857 @@
+#include <mgos.h>
+
+#include "esp_sleep.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 #include "DallasESP32.h"
 #include "OnewireESP32.h"
+#include "OnewireESP32Uart.h"
+#include "onewire_crc.h"
+
+// DS18S20 family code, 0.5 Deg. resolution and COUNT_REMAIN
+#define DS18S20_FAMILY 0x10
+// Read Scratchpad command
+#define CMD_READ_SCRATCHPAD 0xBE
+// temperature register at power-on, centi-degrees
+#define POWER_ON_TEMP 8500
+// scratchpad commands
+#define CMD_WRITE_SCRATCHPAD 0x4E
+#define CMD_COPY_SCRATCHPAD 0x48
+#define CMD_RECALL_E2 0xB8
+// EEPROM write time of Copy Scratchpad [ms]
+#define COPY_SCRATCHPAD_MS 10
+// scratchpad bytes
+#define SP_HIGH_ALARM 2
+#define SP_LOW_ALARM 3
+#define SP_CONFIGURATION 4
+// memory function commands
+#define CMD_READ_MEMORY 0xF0
+#define CMD_EXT_READ_MEMORY 0xA5
+// CRC16 protected page size of the Extended Read Memory command
+#define MEMORY_PAGE_SIZE 32
+// DS2431 family code, has no Extended Read Memory command
+#define DS2431_FAMILY 0x2D
+
+// a device is sampled by scheduleTick() when its next sample is at most
+// that close [ms]
+#ifndef OW_SCHEDULE_TOLERANCE_MS
+#define OW_SCHEDULE_TOLERANCE_MS 20
+#endif
+
+// how often the DallasESP32 entry points search a Skip ROM bus again [ms], a
+// new device is noticed at the latest after this time
+#ifndef OW_SKIP_ROM_VERIFY_MS
+#define OW_SKIP_ROM_VERIFY_MS 60000
+#endif
+
+// period of the read slot polling of a conversion [ms]
+#ifndef OW_CONVERSION_POLL_MS
+#define OW_CONVERSION_POLL_MS 10
+#endif
+
+namespace {
+
+// holds the bus for the scope, with the priority of the calling task
+class BusGuard {
+ public:
+  explicit BusGuard(struct onewire_bus_lock *lock) : _lock(lock) {
+    onewire_bus_lock_take(_lock, OW_BUS_LOCK_TASK_PRIO);
+  }
+  ~BusGuard() {
+    onewire_bus_lock_give(_lock);
+  }
+
+ private:
+  struct onewire_bus_lock *_lock;
+};
+
+}  // namespace
 
 DallasESP32::DallasESP32(uint8_t pin, uint8_t rmt_rx, uint8_t rmt_tx)
     : Dallas() {
-  _ow = new OnewireESP32(pin, rmt_rx, rmt_tx);
+  _bus = new OnewireESP32(pin, rmt_rx, rmt_tx);
+  _ow = _bus;
+  _ownOnewire = true;
+  init();
+}
+
+DallasESP32::DallasESP32(uint8_t pin, enum mgos_dallas_backend backend,
+                         uint8_t ch_a, uint8_t ch_b)
+    : Dallas() {
+  if (backend == MGOS_DALLAS_BACKEND_UART) {
+    _bus = new OnewireESP32Uart(pin, ch_a);
+  } else {
+    _bus = new OnewireESP32(pin, ch_a, ch_b);
+  }
+  _ow = _bus;
+  _ownOnewire = true;
+  init();
+}
+
+DallasESP32::DallasESP32(OnewireESP32Bus *bus) : Dallas() {
+  _bus = bus;
+  _ow = _bus;
   _ownOnewire = true;
+  init();
+}
+
+void DallasESP32::init() {
+  _busLock = _bus->busLock();
+  _deviceCount = 0;
+  _devicesLoaded = false;
+  _singleVerified = 0;
+  _waitStrategy = MGOS_DALLAS_WAIT_BUSY;
+  _fullReadEvery = 1;
+  _maxJump = 0;
+  _cycle = 0;
+  _scheduleCount = 0;
+  _defaultInterval = 0;
+  _notifyCount = 0;
+  _eventCount = 0;
+  _defaultDelta = 0;
+  _seq = 0;
+  _snapshots[0].count = 0;
+  _snapshots[1].count = 0;
 }
 
 DallasESP32::~DallasESP32() {
 }
+
+void DallasESP32::begin(void) {
+  BusGuard guard(_busLock);
+  Dallas::begin();
+  refreshDevices();
+}
+
+int DallasESP32::refreshDevices(void) {
+  BusGuard guard(_busLock);
+  Device found[MGOS_DALLAS_ESP32_MAX_READINGS];
+  DeviceAddress rom;
+  int count = 0;
+  // one pass of the search, getAddress() restarts it for every index
+  _ow->reset_search();
+  while (count < MGOS_DALLAS_ESP32_MAX_READINGS && _ow->search(rom)) {
+    if (!validAddress(rom)) continue;
+    Device *d = &found[count++];
+    memcpy(d->rom, rom, sizeof(rom));
+    // keep what is known about the devices still present
+    const Device *known = _devicesLoaded ? findDevice(rom) : nullptr;
+    d->resolution = known != nullptr ? known->resolution : 0;
+  }
+  memcpy(_devices, found, count * sizeof(*found));
+  _deviceCount = count;
+  _devicesLoaded = true;
+  // the search from the start told the bus whether it has a single device
+  _singleVerified = mgos_uptime_micros();
+  return count;
+}
+
+// With Skip ROM a device added since the last search would answer along with
+// the known one; search again at this explicit point, not inside a random
+// transaction.
+void DallasESP32::verifySingle(void) {
+  if (!_bus->getSingleDevice(nullptr)) return;
+  if (mgos_uptime_micros() - _singleVerified <
+      (int64_t) OW_SKIP_ROM_VERIFY_MS * 1000) {
+    return;
+  }
+  refreshDevices();
+}
+
+void DallasESP32::lockBus(int priority) {
+  onewire_bus_lock_take(_busLock, priority);
+}
+
+void DallasESP32::unlockBus(void) {
+  onewire_bus_lock_give(_busLock);
+}
+
+bool DallasESP32::readTemperature(const uint8_t *deviceAddress,
+                                  int32_t *temp) {
+  bool parasite;
+  uint32_t epoch;
+  {
+    BusGuard guard(_busLock);
+    verifySingle();
+    parasite = isParasitePowerMode();
+    bool wait = getWaitForConversion();
+    setWaitForConversion(false);
+    bool ok = Dallas::requestTemperaturesByAddress(deviceAddress);
+    setWaitForConversion(wait);
+    if (!ok) return false;
+    // parasite powered sensors keep the strong pull-up, and the bus
+    if (parasite) waitConversion(false, 0);
+    epoch = onewire_bus_lock_epoch(_busLock);
+  }
+  // other tasks may use the bus during the conversion
+  if (!parasite) waitConversion(true, epoch);
+
+  BusGuard guard(_busLock);
+  return readTemp(deviceAddress, true, temp);
+}
+
+void DallasESP32::setSingleDevice(const uint8_t *deviceAddress) {
+  BusGuard guard(_busLock);
+  _bus->setSingleDevice(deviceAddress);
+  // trusted until the next verification
+  _singleVerified = mgos_uptime_micros();
+}
+
+bool DallasESP32::getSingleDevice(uint8_t *deviceAddress) {
+  BusGuard guard(_busLock);
+  return _bus->getSingleDevice(deviceAddress);
+}
+
+bool DallasESP32::readMemory(const uint8_t *deviceAddress, uint16_t memAddress,
+                             uint8_t *buf, uint16_t count, bool checkCrc) {
+  if (checkCrc && deviceAddress != nullptr &&
+      deviceAddress[0] == DS2431_FAMILY) {
+    LOG(LL_ERROR, ("DS2431 has no Extended Read Memory, can't check the CRC"));
+    return false;
+  }
+  uint8_t cmd[3];
+  cmd[0] = checkCrc ? CMD_EXT_READ_MEMORY : CMD_READ_MEMORY;
+  cmd[1] = memAddress & 0xFF;
+  cmd[2] = memAddress >> 8;
+
+  BusGuard guard(_busLock);
+  if (!_ow->reset()) return false;
+  if (deviceAddress != nullptr) {
+    _ow->select(deviceAddress);
+  } else {
+    _ow->skip();
+  }
+  _ow->write_bytes(cmd, sizeof(cmd), false);
+
+  if (!checkCrc) {
+    // the backends read several bytes per driver round trip
+    bool ok = _bus->readBytes(buf, count);
+    _ow->reset();
+    return ok;
+  }
+
+  // Extended Read Memory: every page is followed by its inverted CRC16.
+  // The CRC of the first page also covers the command and target address.
+  uint16_t crc = onewire_crc16(0, cmd, sizeof(cmd));
+  while (count > 0) {
+    uint16_t pageLeft = MEMORY_PAGE_SIZE - (memAddress % MEMORY_PAGE_SIZE);
+    uint8_t page[MEMORY_PAGE_SIZE + 2];
+
+    if (!_bus->readBytes(page, pageLeft + 2)) {
+      _ow->reset();
+      return false;
+    }
+    crc = onewire_crc16(crc, page, pageLeft);
+    if ((uint16_t) ~crc != (page[pageLeft] | (page[pageLeft + 1] << 8))) {
+      LOG(LL_ERROR, ("CRC16 mismatch at address 0x%04x", memAddress));
+      _ow->reset();
+      return false;
+    }
+
+    uint16_t n = count < pageLeft ? count : pageLeft;
+    memcpy(buf, page, n);
+    buf += n;
+    count -= n;
+    memAddress += pageLeft;
+    crc = 0;
+  }
+
+  _ow->reset();
+  return true;
+}
+
+int DallasESP32::broadcastConfig(int8_t high, int8_t low,
+                                 uint8_t resolution) {
+  if (resolution < 9) resolution = 9;
+  if (resolution > 12) resolution = 12;
+  uint8_t config[3];
+  config[0] = (uint8_t) high;
+  config[1] = (uint8_t) low;
+  config[2] = ((resolution - 9) << 5) | 0x1F;
+
+  BusGuard guard(_busLock);
+  if (!_ow->reset()) return -1;
+  _ow->skip();
+  _ow->write(CMD_WRITE_SCRATCHPAD, 0);
+  // DS18S20 only takes TH and TL and ignores the configuration byte
+  _ow->write_bytes(config, sizeof(config), false);
+
+  // one EEPROM write for all the devices, parasite powered ones need the
+  // strong pull-up for the whole write
+  _ow->reset();
+  _ow->skip();
+  _ow->write(CMD_COPY_SCRATCHPAD, 1);
+  // one more tick, the current one may be almost over
+  vTaskDelay(COPY_SCRATCHPAD_MS / portTICK_PERIOD_MS + 1);
+  _ow->depower();
+
+  // reload the scratchpads from the EEPROMs to verify what was stored
+  _ow->reset();
+  _ow->skip();
+  _ow->write(CMD_RECALL_E2, 0);
+  vTaskDelay(1);
+
+  int fallbacks = 0;
+  if (!_devicesLoaded) refreshDevices();
+  for (int i = 0; i < _deviceCount; ++i) {
+    Device *d = &_devices[i];
+    ScratchPad sp;
+    // temperature, TH, TL and configuration: no CRC, a corrupted read only
+    // costs one needless write
+    if (!_ow->reset()) continue;
+    _ow->select(d->rom);
+    _ow->write(CMD_READ_SCRATCHPAD, 0);
+    bool ok = _bus->readBytes(sp, SP_CONFIGURATION + 1);
+    _ow->reset();
+    // a missing device reads as all ones
+    if (!ok || (sp[0] == 0xFF && sp[1] == 0xFF &&
+                sp[SP_CONFIGURATION] == 0xFF)) {
+      continue;
+    }
+    // DS18S20 converts in 750 ms like 12 bits
+    d->resolution = d->rom[0] == DS18S20_FAMILY ? 12 : resolution;
+    if (sp[SP_HIGH_ALARM] == config[0] && sp[SP_LOW_ALARM] == config[1] &&
+        (d->rom[0] == DS18S20_FAMILY || sp[SP_CONFIGURATION] == config[2])) {
+      continue;
+    }
+    LOG(LL_WARN, ("Device %d didn't take the broadcast config", i));
+    // Write Scratchpad only takes TH, TL and the configuration
+    sp[SP_HIGH_ALARM] = config[0];
+    sp[SP_LOW_ALARM] = config[1];
+    sp[SP_CONFIGURATION] = config[2];
+    writeScratchPad(d->rom, sp);
+    fallbacks++;
+  }
+  return fallbacks;
+}
+
+uint8_t DallasESP32::getMaxResolution(void) {
+  uint8_t res = 0;
+  for (int i = 0; i < _deviceCount; ++i) {
+    uint8_t r = _devices[i].resolution;
+    if (r == 0) r = getResolution();
+    if (r > res) res = r;
+  }
+  return res != 0 ? res : getResolution();
+}
+
+void DallasESP32::setWaitStrategy(enum mgos_dallas_wait_strategy strategy) {
+  _waitStrategy = strategy;
+}
+
+enum mgos_dallas_wait_strategy DallasESP32::getWaitStrategy() const {
+  return _waitStrategy;
+}
+
+void DallasESP32::requestTemperatures(void) {
+  uint32_t epoch;
+  {
+    BusGuard guard(_busLock);
+    verifySingle();
+    // only send the convert command, the wait is done here
+    bool wait = getWaitForConversion();
+    setWaitForConversion(false);
+    Dallas::requestTemperatures();
+    setWaitForConversion(wait);
+    if (!wait) return;
+    if (isParasitePowerMode()) {
+      // the strong pull-up powers the conversion, the bus stays ours
+      waitConversion(false, 0);
+      return;
+    }
+    epoch = onewire_bus_lock_epoch(_busLock);
+  }
+  // other tasks may use the bus during the conversion, whatever the
+  // wait strategy
+  waitConversion(true, epoch);
+}
+
+bool DallasESP32::requestTemperaturesByAddress(const uint8_t *deviceAddress) {
+  uint32_t epoch;
+  {
+    BusGuard guard(_busLock);
+    verifySingle();
+    bool wait = getWaitForConversion();
+    setWaitForConversion(false);
+    bool ok = Dallas::requestTemperaturesByAddress(deviceAddress);
+    setWaitForConversion(wait);
+    if (!ok || !wait) return ok;
+    if (isParasitePowerMode()) {
+      waitConversion(false, 0);
+      return true;
+    }
+    epoch = onewire_bus_lock_epoch(_busLock);
+  }
+  waitConversion(true, epoch);
+  return true;
+}
+
+bool DallasESP32::requestTemperaturesByIndex(uint8_t index) {
+  uint8_t deviceAddress[8];
+  {
+    BusGuard guard(_busLock);
+    // the devices table saves the search of getAddress()
+    if (!_devicesLoaded) refreshDevices();
+    if (index >= _deviceCount) return false;
+    memcpy(deviceAddress, _devices[index].rom, sizeof(deviceAddress));
+  }
+  return requestTemperaturesByAddress(deviceAddress);
+}
+
+// Wait for the conversion started while the bus lock epoch was `epoch`.
+// With `poll`, getCheckForConversion() and externally powered devices, the
+// devices are asked every OW_CONVERSION_POLL_MS with a read slot, as long as
+// no other task used the bus meanwhile. Otherwise the whole conversion time
+// of the resolution is waited.
+void DallasESP32::waitConversion(bool poll, uint32_t epoch) {
+  int16_t ms = millisToWaitForConversion(getMaxResolution());
+  if (!poll || !getCheckForConversion() || isParasitePowerMode()) {
+    waitFor(ms);
+    return;
+  }
+
+  int64_t deadline = mgos_uptime_micros() + (int64_t) ms * 1000;
+  for (;;) {
+    int64_t left = (deadline - mgos_uptime_micros() + 999) / 1000;
+    if (left <= 0) return;
+    waitFor(left < OW_CONVERSION_POLL_MS ? (uint32_t) left
+                                         : OW_CONVERSION_POLL_MS);
+    BusGuard guard(_busLock);
+    // another task reset the bus, the devices no longer answer the slots
+    if (onewire_bus_lock_epoch(_busLock) != epoch) break;
+    // the devices hold the read slots low until the conversion is done
+    if (_ow->read_bit()) return;
+  }
+  int64_t left = (deadline - mgos_uptime_micros() + 999) / 1000;
+  if (left > 0) waitFor((uint32_t) left);
+}
+
+void DallasESP32::waitFor(uint32_t ms) {
+  if (_waitStrategy == MGOS_DALLAS_WAIT_BUSY) {
+    mgos_usleep(ms * 1000);
+    return;
+  }
+  if (_waitStrategy == MGOS_DALLAS_WAIT_LIGHT_SLEEP) {
+    // GPIO levels are kept in light sleep, so does the strong pull-up
+    // of parasite powered devices
+    esp_sleep_enable_timer_wakeup((uint64_t) ms * 1000);
+    if (esp_light_sleep_start() == ESP_OK) return;
+    LOG(LL_WARN, ("Light sleep failed, waiting with vTaskDelay"));
+  }
+  // round up to whole ticks
+  vTaskDelay((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+int DallasESP32::publishReadings() {
+  struct mgos_dallas_reading readings[MGOS_DALLAS_ESP32_MAX_READINGS];
+  int count;
+  {
+    // more urgent tasks get the bus between two devices, at their reset
+    BusGuard guard(_busLock);
+    if (!_devicesLoaded) refreshDevices();
+    verifySingle();
+    count = _deviceCount;
+
+    // do the bus I/O outside of the seqlock write section
+    for (int i = 0; i < count; ++i) {
+      struct mgos_dallas_reading *r = &readings[i];
+      memcpy(r->rom, _devices[i].rom, sizeof(r->rom));
+      readDevice(r);
+    }
+
+    publish(readings, count);
+    notify(readings, count);
+    _cycle++;
+  }
+  deliverEvents();
+  return count;
+}
+
+void DallasESP32::readDevice(struct mgos_dallas_reading *r) {
+  if (readTempPolicy(r->rom, &r->temp)) {
+    r->status = MGOS_DALLAS_READING_OK;
+  } else {
+    r->temp = DEVICE_DISCONNECTED_C * 100;
+    r->status = MGOS_DALLAS_READING_DISCONNECTED;
+  }
+  r->timestamp = mgos_uptime_micros();
+}
+
+void DallasESP32::setSampleInterval(const uint8_t *deviceAddress,
+                                    uint32_t intervalMs) {
+  if (deviceAddress == nullptr) {
+    _defaultInterval = intervalMs;
+    for (int i = 0; i < _scheduleCount; ++i) {
+      if (!_schedule[i].configured) _schedule[i].interval = intervalMs;
+    }
+    return;
+  }
+  Schedule *s = findSchedule(deviceAddress);
+  if (s == nullptr) return;
+  s->interval = intervalMs;
+  s->configured = true;
+}
+
+DallasESP32::Schedule *DallasESP32::findSchedule(const uint8_t *rom) {
+  for (int i = 0; i < _scheduleCount; ++i) {
+    if (memcmp(_schedule[i].rom, rom, sizeof(_schedule[i].rom)) == 0) {
+      return &_schedule[i];
+    }
+  }
+  if (_scheduleCount >= MGOS_DALLAS_ESP32_MAX_READINGS) return nullptr;
+  Schedule *s = &_schedule[_scheduleCount++];
+  memcpy(s->rom, rom, sizeof(s->rom));
+  s->interval = _defaultInterval;
+  s->next = 0;
+  s->configured = false;
+  return s;
+}
+
+int DallasESP32::scheduleTick() {
+  struct mgos_dallas_reading readings[MGOS_DALLAS_ESP32_MAX_READINGS];
+  bool due[MGOS_DALLAS_ESP32_MAX_READINGS];
+  int64_t now = mgos_uptime_micros();
+  int count;
+  int numDue = 0;
+  bool parasite;
+  bool skipRom;
+  uint32_t epoch;
+
+  {
+    BusGuard guard(_busLock);
+    if (!_devicesLoaded) refreshDevices();
+    verifySingle();
+    count = _deviceCount;
+    for (int i = 0; i < count; ++i) {
+      due[i] = false;
+      memcpy(readings[i].rom, _devices[i].rom, sizeof(readings[i].rom));
+      Schedule *s = findSchedule(readings[i].rom);
+      // a tick slightly early because of jitter still samples
+      if (s == nullptr ||
+          now >= s->next - (int64_t) OW_SCHEDULE_TOLERANCE_MS * 1000) {
+        due[i] = true;
+        numDue++;
+        if (s == nullptr) continue;
+        // keep the phase, re-base only after the first sample or when a
+        // whole interval was missed
+        int64_t interval = (int64_t) s->interval * 1000;
+        if (s->next == 0 || s->next + interval <= now) {
+          s->next = now + interval;
+        } else {
+          s->next += interval;
+        }
+      }
+    }
+    if (numDue == 0) return 0;
+
+    // one Skip ROM convert when most sensors are due, per ROM otherwise
+    parasite = isParasitePowerMode();
+    bool wait = getWaitForConversion();
+    setWaitForConversion(false);
+    // parasite powered sensors convert together under one strong pull-up
+    skipRom = parasite || 2 * numDue > count;
+    if (skipRom) {
+      Dallas::requestTemperatures();
+    } else {
+      for (int i = 0; i < count; ++i) {
+        if (due[i]) Dallas::requestTemperaturesByAddress(readings[i].rom);
+      }
+    }
+    setWaitForConversion(wait);
+    // the strong pull-up powers the conversion, the bus stays ours
+    if (parasite) waitConversion(false, 0);
+    epoch = onewire_bus_lock_epoch(_busLock);
+  }
+  // other tasks may use the bus during the conversion; after per ROM
+  // converts only the last device would answer the read slots
+  if (!parasite) waitConversion(skipRom, epoch);
+
+  {
+    BusGuard guard(_busLock);
+    // read only the due sensors, the others keep their published reading
+    for (int i = 0; i < count; ++i) {
+      struct mgos_dallas_reading *r = &readings[i];
+      if (due[i]) {
+        readDevice(r);
+        continue;
+      }
+      r->status = MGOS_DALLAS_READING_DISCONNECTED;
+      r->temp = DEVICE_DISCONNECTED_C * 100;
+      r->timestamp = 0;
+      // the writer may read its own snapshot without the sequence check
+      const Snapshot &snap = published();
+      for (int j = 0; j < snap.count; ++j) {
+        if (memcmp(snap.readings[j].rom, r->rom, sizeof(r->rom)) == 0) {
+          *r = snap.readings[j];
+          break;
+        }
+      }
+    }
+
+    publish(readings, count);
+    notify(readings, count);
+    _cycle++;
+  }
+  deliverEvents();
+  return numDue;
+}
+
+void DallasESP32::setReadPolicy(uint16_t fullReadEvery, int32_t maxJump) {
+  _fullReadEvery = fullReadEvery;
+  _maxJump = maxJump;
+}
+
+DallasESP32::Device *DallasESP32::findDevice(const uint8_t *rom) {
+  for (int i = 0; i < _deviceCount; ++i) {
+    if (memcmp(_devices[i].rom, rom, sizeof(_devices[i].rom)) == 0) {
+      return &_devices[i];
+    }
+  }
+  return nullptr;
+}
+
+bool DallasESP32::readTemp(const uint8_t *rom, bool full, int32_t *temp) {
+  ScratchPad sp;
+  int16_t raw;
+  uint8_t res = 12;
+  Device *d = findDevice(rom);
+
+  if (full) {
+    // reads the whole scratchpad and checks the CRC
+    if (!isConnected(rom, sp)) return false;
+    // R1 R0 of the configuration register, 9..12 bits
+    res = 9 + ((sp[SP_CONFIGURATION] >> 5) & 0x03);
+    if (d != nullptr) d->resolution = res;
+  } else {
+    // the mask of the low bits needs the resolution of this device
+    if (rom[0] != DS18S20_FAMILY) {
+      if (d == nullptr || d->resolution == 0) return false;
+      res = d->resolution;
+    }
+    // the reset after the temperature bytes ends the read
+    if (!_ow->reset()) return false;
+    _ow->select(rom);
+    _ow->write(CMD_READ_SCRATCHPAD, 0);
+    // a timed out read leaves the buffer untouched
+    bool ok = _bus->readBytes(sp, 2);
+    _ow->reset();
+    // a missing device reads as all ones
+    if (!ok || (sp[0] == 0xFF && sp[1] == 0xFF)) return false;
+  }
+
+  raw = (int16_t) ((sp[1] << 8) | sp[0]);
+  if (rom[0] == DS18S20_FAMILY) {
+    if (full && sp[7] != 0) {
+      // extended resolution: T = T_READ - 0.25 + (COUNT_PER_C - COUNT_REMAIN)
+      // / COUNT_PER_C
+      *temp = (raw >> 1) * 100 - 25 + ((sp[7] - sp[6]) * 100) / sp[7];
+    } else {
+      *temp = raw * 50;
+    }
+  } else {
+    // the undefined low bits depend on the resolution of the device
+    if (res < 12) raw &= ~((1 << (12 - res)) - 1);
+    *temp = (raw * 100) / 16;
+  }
+  return true;
+}
+
+bool DallasESP32::readTempPolicy(const uint8_t *rom, int32_t *temp) {
+  bool full = _fullReadEvery == 1 ||
+              (_fullReadEvery > 1 && (_cycle % _fullReadEvery) == 0);
+  // with Skip ROM a device added since the last search would answer too,
+  // only the CRC of a full read notices the collision
+  if (full || _bus->getSingleDevice(nullptr)) {
+    return readTemp(rom, true, temp);
+  }
+
+  if (!readTemp(rom, false, temp)) return readTemp(rom, true, temp);
+  if (*temp == POWER_ON_TEMP) return readTemp(rom, true, temp);
+  if (_maxJump > 0) {
+    // the writer may read its own snapshot without the sequence check
+    const Snapshot &snap = published();
+    for (int i = 0; i < snap.count; ++i) {
+      const struct mgos_dallas_reading *r = &snap.readings[i];
+      if (memcmp(r->rom, rom, sizeof(r->rom)) == 0) {
+        if (r->status == MGOS_DALLAS_READING_OK &&
+            abs(*temp - r->temp) > _maxJump) {
+          return readTemp(rom, true, temp);
+        }
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+void DallasESP32::publish(const struct mgos_dallas_reading *readings,
+                          int count) {
+  // single writer: only the polling task publishes, into the buffer the
+  // readers don't use
+  uint32_t seq = _seq;
+  Snapshot *next = &_snapshots[(seq + 1) & 1];
+  memcpy(next->readings, readings, count * sizeof(*readings));
+  next->count = count;
+  __atomic_store_n(&_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+const DallasESP32::Snapshot &DallasESP32::published(void) const {
+  return _snapshots[__atomic_load_n(&_seq, __ATOMIC_ACQUIRE) & 1];
+}
+
+// The buffer being read is only rewritten by the publish after the next
+// one, a reader copies again if the sequence moved meanwhile.
+int DallasESP32::getReadings(struct mgos_dallas_reading *out, int max) const {
+  uint32_t seq1, seq2;
+  int count;
+  do {
+    seq1 = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+    const Snapshot &snap = _snapshots[seq1 & 1];
+    count = snap.count;
+    if (count > max) count = max;
+    memcpy(out, snap.readings, count * sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq2 = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+  } while (seq1 != seq2);
+  return count;
+}
+
+bool DallasESP32::getReading(const uint8_t *deviceAddress,
+                             struct mgos_dallas_reading *out) const {
+  uint32_t seq1, seq2;
+  bool found;
+  do {
+    seq1 = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+    const Snapshot &snap = _snapshots[seq1 & 1];
+    found = false;
+    for (int i = 0; i < snap.count; ++i) {
+      if (memcmp(snap.readings[i].rom, deviceAddress, 8) == 0) {
+        *out = snap.readings[i];
+        found = true;
+        break;
+      }
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq2 = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+  } while (seq1 != seq2);
+  return found;
+}
+
+bool DallasESP32::setNotify(const uint8_t *deviceAddress, int32_t delta,
+                            int32_t low, int32_t high) {
+  if (deviceAddress == nullptr) {
+    _defaultDelta = delta;
+    for (int i = 0; i < _notifyCount; ++i) {
+      if (!_notify[i].configured) _notify[i].delta = delta;
+    }
+    return true;
+  }
+  Notify *n = findNotify(deviceAddress, true);
+  if (n == nullptr) return false;
+  n->delta = delta;
+  n->low = low;
+  n->high = high;
+  n->configured = true;
+  if (n->present) n->zone = zoneOf(n, n->lastTemp);
+  return true;
+}
+
+DallasESP32::Notify *DallasESP32::findNotify(const uint8_t *rom, bool create) {
+  for (int i = 0; i < _notifyCount; ++i) {
+    if (memcmp(_notify[i].rom, rom, sizeof(_notify[i].rom)) == 0) {
+      return &_notify[i];
+    }
+  }
+  if (!create || _notifyCount >= MGOS_DALLAS_ESP32_MAX_READINGS) {
+    return nullptr;
+  }
+  Notify *n = &_notify[_notifyCount++];
+  memcpy(n->rom, rom, sizeof(n->rom));
+  n->delta = _defaultDelta;
+  n->low = n->high = 0;
+  n->lastTemp = DEVICE_DISCONNECTED_C * 100;
+  n->zone = ZONE_NORMAL;
+  n->present = false;
+  n->configured = false;
+  return n;
+}
+
+uint8_t DallasESP32::zoneOf(const Notify *n, int32_t temp) const {
+  if (n->low >= n->high) return ZONE_NORMAL;
+  if (temp < n->low) return ZONE_LOW;
+  if (temp > n->high) return ZONE_HIGH;
+  return ZONE_NORMAL;
+}
+
+void DallasESP32::trigger(int ev, const struct mgos_dallas_reading *reading,
+                          int32_t prevTemp) {
+  if (_eventCount >= (int) (sizeof(_events) / sizeof(_events[0]))) return;
+  PendingEvent *e = &_events[_eventCount++];
+  e->ev = ev;
+  e->data.dt = this;
+  e->data.reading = *reading;
+  e->data.prev_temp = prevTemp;
+}
+
+// Call without the bus: the handlers run on the mgos task, where mJS
+// handlers are safe and the bus may be used again.
+void DallasESP32::deliverEvents(void) {
+  for (int i = 0; i < _eventCount; ++i) {
+    PendingEvent *e = new PendingEvent(_events[i]);
+    if (!mgos_invoke_cb(eventCb, e, false)) {
+      LOG(LL_ERROR, ("Event %d dropped, mgos queue full", _events[i].ev));
+      delete e;
+    }
+  }
+  _eventCount = 0;
+}
+
+void DallasESP32::eventCb(void *arg) {
+  PendingEvent *e = static_cast<PendingEvent *>(arg);
+  mgos_event_trigger(e->ev, &e->data);
+  delete e;
+}
+
+void DallasESP32::notify(const struct mgos_dallas_reading *readings,
+                         int count) {
+  bool seen[MGOS_DALLAS_ESP32_MAX_READINGS] = {false};
+
+  for (int i = 0; i < count; ++i) {
+    const struct mgos_dallas_reading *r = &readings[i];
+    if (r->status == MGOS_DALLAS_READING_DISCONNECTED) continue;
+    Notify *n = findNotify(r->rom, true);
+    if (n == nullptr) continue;
+    seen[n - _notify] = true;
+
+    int32_t prev = n->lastTemp;
+    if (!n->present) {
+      n->present = true;
+      n->lastTemp = r->temp;
+      n->zone = zoneOf(n, r->temp);
+      trigger(MGOS_DALLAS_ESP32_EV_FOUND, r, prev);
+      continue;
+    }
+    uint8_t zone = zoneOf(n, r->temp);
+    if (zone != n->zone) {
+      n->zone = zone;
+      n->lastTemp = r->temp;
+      trigger(MGOS_DALLAS_ESP32_EV_THRESHOLD, r, prev);
+    } else if (n->delta > 0 && abs(r->temp - prev) > n->delta) {
+      n->lastTemp = r->temp;
+      trigger(MGOS_DALLAS_ESP32_EV_CHANGED, r, prev);
+    }
+  }
+
+  for (int i = 0; i < _notifyCount; ++i) {
+    Notify *n = &_notify[i];
+    if (seen[i] || !n->present) continue;
+    n->present = false;
+    struct mgos_dallas_reading r;
+    memcpy(r.rom, n->rom, sizeof(r.rom));
+    r.temp = DEVICE_DISCONNECTED_C * 100;
+    r.timestamp = mgos_uptime_micros();
+    r.status = MGOS_DALLAS_READING_DISCONNECTED;
+    trigger(MGOS_DALLAS_ESP32_EV_LOST, &r, n->lastTemp);
+  }
+}
@@ -0,0 +1,91 @@
+#include <mgos.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "DallasESP32Group.h"
+
+DallasESP32Group::DallasESP32Group(const uint8_t *pins, uint8_t count,
+                                   uint8_t rmt_rx, uint8_t rmt_tx)
+    : _buses(new DallasESP32 *[count]), _count(count), _next(0) {
+  // the first bus installs the RMT channels, the others share them
+  for (uint8_t i = 0; i < count; ++i) {
+    _buses[i] = new DallasESP32(pins[i], rmt_rx, rmt_tx);
+  }
+}
+
+DallasESP32Group::~DallasESP32Group() {
+  for (uint8_t i = 0; i < _count; ++i) {
+    delete _buses[i];
+  }
+  delete[] _buses;
+}
+
+void DallasESP32Group::begin(void) {
+  for (uint8_t i = 0; i < _count; ++i) {
+    _buses[i]->begin();
+  }
+}
+
+uint8_t DallasESP32Group::getBusCount(void) const {
+  return _count;
+}
+
+DallasESP32 *DallasESP32Group::getBus(uint8_t index) const {
+  return index < _count ? _buses[index] : nullptr;
+}
+
+int DallasESP32Group::getDeviceCount(void) {
+  int count = 0;
+  for (uint8_t i = 0; i < _count; ++i) {
+    count += _buses[i]->getDeviceCount();
+  }
+  return count;
+}
+
+int DallasESP32Group::sweep(void) {
+  int16_t ms = 0;
+
+  for (uint8_t i = 0; i < _count; ++i) {
+    DallasESP32 *bus = _buses[i];
+    if (bus->getDeviceCount() == 0) continue;
+    if (bus->isParasitePowerMode()) {
+      // keep the strong pull-up until the conversion ends
+      bool wait = bus->getWaitForConversion();
+      bus->setWaitForConversion(true);
+      bus->requestTemperatures();
+      bus->setWaitForConversion(wait);
+      continue;
+    }
+    bool wait = bus->getWaitForConversion();
+    bus->setWaitForConversion(false);
+    bus->requestTemperatures();
+    bus->setWaitForConversion(wait);
+    int16_t busMs = bus->millisToWaitForConversion(bus->getMaxResolution());
+    if (busMs > ms) ms = busMs;
+  }
+
+  if (ms > 0) {
+    vTaskDelay((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+  }
+
+  int count = 0;
+  for (uint8_t i = 0; i < _count; ++i) {
+    if (_buses[i]->getDeviceCount() == 0) continue;
+    count += _buses[i]->publishReadings();
+  }
+  return count;
+}
+
+int DallasESP32Group::sweepNext(void) {
+  if (_count == 0) return 0;
+  DallasESP32 *bus = _buses[_next];
+  _next = (_next + 1) % _count;
+  if (bus->getDeviceCount() == 0) return 0;
+
+  bool wait = bus->getWaitForConversion();
+  bus->setWaitForConversion(true);
+  bus->requestTemperatures();
+  bus->setWaitForConversion(wait);
+  return bus->publishReadings();
+}
@@ -27,8 +27,7 @@ void OnewireESP32::skip(void) {
 }
 
 void OnewireESP32::write(uint8_t v, uint8_t power) {
-  onewire_rmt_write(_ow, v);
-  (void) power;
+  onewire_rmt_write_power(_ow, v, power);
 }
 
 void OnewireESP32::write_bytes(const uint8_t *buf, uint16_t count, bool power) {
@@ -44,6 +43,10 @@ void OnewireESP32::read_bytes(uint8_t *buf, uint16_t count) {
   onewire_rmt_read_bytes(_ow, buf, count);
 }
 
+bool OnewireESP32::readBytes(uint8_t *buf, uint16_t count) {
+  return onewire_rmt_read_bytes(_ow, buf, count);
+}
+
 void OnewireESP32::write_bit(uint8_t v) {
   onewire_rmt_write_bit(_ow, v);
 }
@@ -53,6 +56,7 @@ uint8_t OnewireESP32::read_bit(void) {
 }
 
 void OnewireESP32::depower(void) {
+  onewire_rmt_depower(_ow);
 }
 
 void OnewireESP32::reset_search() {
@@ -66,3 +70,15 @@ void OnewireESP32::target_search(uint8_t family_code) {
 uint8_t OnewireESP32::search(uint8_t *newAddr, bool search_mode) {
   return (uint8_t) onewire_rmt_next(_ow, newAddr, !search_mode);
 }
+
+struct onewire_bus_lock *OnewireESP32::busLock() {
+  return _ow ? onewire_rmt_bus_lock(_ow) : nullptr;
+}
+
+void OnewireESP32::setSingleDevice(const uint8_t *rom) {
+  if (_ow) onewire_rmt_set_single(_ow, rom);
+}
+
+bool OnewireESP32::getSingleDevice(uint8_t *rom) {
+  return _ow ? onewire_rmt_get_single(_ow, rom) : false;
+}
@@ -1,9 +1,9 @@
 #pragma once
-#include "OnewireInterface.h"
+#include "OnewireESP32Bus.h"
 
 struct mgos_rmt_onewire;
 
-class OnewireESP32 : public OnewireInterface {
+class OnewireESP32 : public OnewireESP32Bus {
  public:
   OnewireESP32(uint8_t pin, uint8_t rmt_rx, uint8_t rmt_tx);
 
@@ -41,6 +41,7 @@ class OnewireESP32 : public OnewireInterface {
    */
   virtual uint8_t read(void);
   virtual void read_bytes(uint8_t *buf, uint16_t count);
+  virtual bool readBytes(uint8_t *buf, uint16_t count);
 
   /*
    * Write a bit. The bus is always left powered at the end, see
@@ -83,6 +84,14 @@ class OnewireESP32 : public OnewireInterface {
    */
   virtual uint8_t search(uint8_t *newAddr, bool search_mode = true);
 
+  virtual struct onewire_bus_lock *busLock();
+
+  /*
+   * See onewire_rmt_set_single().
+   */
+  virtual void setSingleDevice(const uint8_t *rom);
+  virtual bool getSingleDevice(uint8_t *rom);
+
  private:
   struct mgos_rmt_onewire *_ow;
 };
@@ -0,0 +1,84 @@
+#include <mgos.h>
+
+#include "OnewireESP32Uart.h"
+#include "onewire_uart.h"
+
+OnewireESP32Uart::OnewireESP32Uart(uint8_t pin, uint8_t uart_num)
+    : _ow(onewire_uart_create(pin, uart_num)) {
+}
+
+OnewireESP32Uart::~OnewireESP32Uart() {
+  // LOG(LL_INFO, ("Delete _ow"));
+  if (_ow) {
+    onewire_uart_close(_ow);
+  }
+}
+
+uint8_t OnewireESP32Uart::reset(void) {
+  return onewire_uart_reset(_ow);
+}
+
+void OnewireESP32Uart::select(const uint8_t rom[8]) {
+  onewire_uart_select(_ow, rom);
+}
+
+void OnewireESP32Uart::skip(void) {
+  onewire_uart_skip(_ow);
+}
+
+void OnewireESP32Uart::write(uint8_t v, uint8_t power) {
+  onewire_uart_write_power(_ow, v, power);
+}
+
+void OnewireESP32Uart::write_bytes(const uint8_t *buf, uint16_t count, bool power) {
+  onewire_uart_write_bytes(_ow, buf, count);
+  (void) power;
+}
+
+uint8_t OnewireESP32Uart::read(void) {
+  return onewire_uart_read(_ow);
+}
+
+void OnewireESP32Uart::read_bytes(uint8_t *buf, uint16_t count) {
+  onewire_uart_read_bytes(_ow, buf, count);
+}
+
+bool OnewireESP32Uart::readBytes(uint8_t *buf, uint16_t count) {
+  return onewire_uart_read_bytes(_ow, buf, count);
+}
+
+void OnewireESP32Uart::write_bit(uint8_t v) {
+  onewire_uart_write_bit(_ow, v);
+}
+
+uint8_t OnewireESP32Uart::read_bit(void) {
+  return (uint8_t) onewire_uart_read_bit(_ow);
+}
+
+void OnewireESP32Uart::depower(void) {
+  onewire_uart_depower(_ow);
+}
+
+void OnewireESP32Uart::reset_search() {
+  onewire_uart_search_clean(_ow);
+}
+
+void OnewireESP32Uart::target_search(uint8_t family_code) {
+  onewire_uart_target_setup(_ow, family_code);
+}
+
+uint8_t OnewireESP32Uart::search(uint8_t *newAddr, bool search_mode) {
+  return (uint8_t) onewire_uart_next(_ow, newAddr, !search_mode);
+}
+
+struct onewire_bus_lock *OnewireESP32Uart::busLock() {
+  return _ow ? onewire_uart_bus_lock(_ow) : nullptr;
+}
+
+void OnewireESP32Uart::setSingleDevice(const uint8_t *rom) {
+  if (_ow) onewire_uart_set_single(_ow, rom);
+}
+
+bool OnewireESP32Uart::getSingleDevice(uint8_t *rom) {
+  return _ow ? onewire_uart_get_single(_ow, rom) : false;
+}
@@ -1,6 +1,186 @@
+#include <mgos.h>
+
 #include "mgos_dallas_esp32.h"
 #include "DallasESP32.h"
+#include "DallasESP32Group.h"
 
 Dallas *mgos_dallas_create_esp32(uint8_t pin, uint8_t rmt_rx, uint8_t rmt_tx) {
   return new DallasESP32(pin, rmt_rx, rmt_tx);
-}
\ No newline at end of file
+}
+
+Dallas *mgos_dallas_create_esp32_backend(uint8_t pin, int backend,
+                                         uint8_t ch_a, uint8_t ch_b) {
+  return new DallasESP32(pin, (enum mgos_dallas_backend) backend, ch_a, ch_b);
+}
+bool mgos_dallas_esp32_read_memory(Dallas *dt, const char *addr, int mem_addr,
+                                   char *buf, int len, bool check_crc) {
+  if (dt == nullptr || buf == nullptr || len <= 0) return false;
+  return static_cast<DallasESP32 *>(dt)->readMemory(
+      (const uint8_t *) addr, mem_addr, (uint8_t *) buf, len, check_crc);
+}
+
+DallasESP32Group *mgos_dallas_esp32_group_create(const uint8_t *pins,
+                                                 int count, uint8_t rmt_rx,
+                                                 uint8_t rmt_tx) {
+  if (pins == nullptr || count <= 0 || count > 255) return nullptr;
+  DallasESP32Group *group =
+      new DallasESP32Group(pins, count, rmt_rx, rmt_tx);
+  group->begin();
+  return group;
+}
+
+void mgos_dallas_esp32_group_close(DallasESP32Group *group) {
+  delete group;
+}
+
+int mgos_dallas_esp32_group_get_bus_count(DallasESP32Group *group) {
+  if (group == nullptr) return 0;
+  return group->getBusCount();
+}
+
+Dallas *mgos_dallas_esp32_group_get_bus(DallasESP32Group *group, int index) {
+  if (group == nullptr || index < 0) return nullptr;
+  return group->getBus(index);
+}
+
+int mgos_dallas_esp32_group_sweep(DallasESP32Group *group) {
+  if (group == nullptr) return 0;
+  return group->sweep();
+}
+
+int mgos_dallas_esp32_group_sweep_next(DallasESP32Group *group) {
+  if (group == nullptr) return 0;
+  return group->sweepNext();
+}
+
+int mgos_dallas_esp32_broadcast_config(Dallas *dt, int high, int low,
+                                       int resolution) {
+  if (dt == nullptr) return -1;
+  return static_cast<DallasESP32 *>(dt)->broadcastConfig(high, low,
+                                                         resolution);
+}
+
+void mgos_dallas_esp32_set_wait_strategy(Dallas *dt, int strategy) {
+  if (dt == nullptr) return;
+  static_cast<DallasESP32 *>(dt)->setWaitStrategy(
+      (enum mgos_dallas_wait_strategy) strategy);
+}
+
+void mgos_dallas_esp32_request_temperatures(Dallas *dt) {
+  if (dt == nullptr) return;
+  static_cast<DallasESP32 *>(dt)->requestTemperatures();
+}
+
+bool mgos_dallas_esp32_request_temperatures_by_address(Dallas *dt,
+                                                       const char *addr) {
+  if (dt == nullptr || addr == nullptr) return false;
+  return static_cast<DallasESP32 *>(dt)->requestTemperaturesByAddress(
+      (const uint8_t *) addr);
+}
+
+bool mgos_dallas_esp32_request_temperatures_by_index(Dallas *dt, int index) {
+  if (dt == nullptr || index < 0) return false;
+  return static_cast<DallasESP32 *>(dt)->requestTemperaturesByIndex(
+      (uint8_t) index);
+}
+
+void mgos_dallas_esp32_set_read_policy(Dallas *dt, int full_read_every,
+                                       int max_jump) {
+  if (dt == nullptr || full_read_every < 0) return;
+  static_cast<DallasESP32 *>(dt)->setReadPolicy(full_read_every, max_jump);
+}
+
+void mgos_dallas_esp32_set_sample_interval(Dallas *dt, const char *addr,
+                                           int interval_ms) {
+  if (dt == nullptr || interval_ms < 0) return;
+  static_cast<DallasESP32 *>(dt)->setSampleInterval((const uint8_t *) addr,
+                                                    interval_ms);
+}
+
+int mgos_dallas_esp32_schedule_tick(Dallas *dt) {
+  if (dt == nullptr) return 0;
+  return static_cast<DallasESP32 *>(dt)->scheduleTick();
+}
+
+int mgos_dallas_esp32_publish_readings(Dallas *dt) {
+  if (dt == nullptr) return 0;
+  return static_cast<DallasESP32 *>(dt)->publishReadings();
+}
+
+bool mgos_dallas_esp32_set_notify(Dallas *dt, const char *addr, int delta,
+                                  int low, int high) {
+  if (dt == nullptr) return false;
+  return static_cast<DallasESP32 *>(dt)->setNotify((const uint8_t *) addr,
+                                                   delta, low, high);
+}
+
+int mgos_dallas_esp32_get_readings(Dallas *dt, struct mgos_dallas_reading *out,
+                                   int max) {
+  if (dt == nullptr || out == nullptr || max <= 0) return 0;
+  return static_cast<DallasESP32 *>(dt)->getReadings(out, max);
+}
+
+bool mgos_dallas_esp32_get_reading(Dallas *dt, const char *addr,
+                                   struct mgos_dallas_reading *out) {
+  if (dt == nullptr || addr == nullptr || out == nullptr) return false;
+  return static_cast<DallasESP32 *>(dt)->getReading((const uint8_t *) addr,
+                                                    out);
+}
+
+int mgos_dallas_esp32_get_snapshot_tempc(Dallas *dt, const char *addr) {
+  struct mgos_dallas_reading r;
+  if (!mgos_dallas_esp32_get_reading(dt, addr, &r) ||
+      r.status == MGOS_DALLAS_READING_DISCONNECTED) {
+    return DEVICE_DISCONNECTED_C * 100;
+  }
+  return r.temp;
+}
+
+void mgos_dallas_esp32_begin(Dallas *dt) {
+  if (dt == nullptr) return;
+  static_cast<DallasESP32 *>(dt)->begin();
+}
+
+void mgos_dallas_esp32_lock_bus(Dallas *dt, int priority) {
+  if (dt == nullptr) return;
+  static_cast<DallasESP32 *>(dt)->lockBus(priority);
+}
+
+void mgos_dallas_esp32_unlock_bus(Dallas *dt) {
+  if (dt == nullptr) return;
+  static_cast<DallasESP32 *>(dt)->unlockBus();
+}
+
+int mgos_dallas_esp32_read_temperature(Dallas *dt, const char *addr) {
+  int32_t temp;
+  if (dt == nullptr || addr == nullptr ||
+      !static_cast<DallasESP32 *>(dt)->readTemperature((const uint8_t *) addr,
+                                                        &temp)) {
+    return DEVICE_DISCONNECTED_C * 100;
+  }
+  return temp;
+}
+
+void mgos_dallas_esp32_set_single_device(Dallas *dt, const char *addr) {
+  if (dt == nullptr) return;
+  static_cast<DallasESP32 *>(dt)->setSingleDevice((const uint8_t *) addr);
+}
+
+bool mgos_dallas_esp32_get_single_device(Dallas *dt, char *addr) {
+  if (dt == nullptr || addr == nullptr) return false;
+  return static_cast<DallasESP32 *>(dt)->getSingleDevice((uint8_t *) addr);
+}
+
+int mgos_dallas_esp32_ev_get_tempc(const struct mgos_dallas_event_data *ev) {
+  return ev->reading.temp;
+}
+
+int mgos_dallas_esp32_ev_get_prev_tempc(
+    const struct mgos_dallas_event_data *ev) {
+  return ev->prev_temp;
+}
+
+void mgos_dallas_esp32_ev_get_address(const struct mgos_dallas_event_data *ev,
+                                      char *addr) {
+  memcpy(addr, ev->reading.rom, sizeof(ev->reading.rom));
+}
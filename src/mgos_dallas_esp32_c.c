@@ -1,5 +1,78 @@
 #include <stdbool.h>
 
+#include "mgos_dallas_esp32.h"
+#include "onewire_bench.h"
+#include "onewire_rmt_trace.h"
+
+#if defined(OW_TRACE) && defined(MGOS_HAVE_RPC_COMMON)
+#include "mgos_rpc.h"
+
+static void ow_trace_dump_handler(struct mg_rpc_request_info *ri, void *cb_arg,
+                                  struct mg_rpc_frame_info *fi,
+                                  struct mg_str args) {
+  char *file = NULL;
+  json_scanf(args.p, args.len, ri->args_fmt, &file);
+  const char *path = file ? file : "ow_trace.bin";
+  int count = onewire_rmt_trace_dump(path);
+  if (count < 0) {
+    mg_rpc_send_errorf(ri, 500, "failed to write %s", path);
+  } else {
+    mg_rpc_send_responsef(ri, "{file: %Q, records: %d}", path, count);
+  }
+  free(file);
+  (void) cb_arg;
+  (void) fi;
+}
+
+static void ow_trace_clear_handler(struct mg_rpc_request_info *ri,
+                                   void *cb_arg, struct mg_rpc_frame_info *fi,
+                                   struct mg_str args) {
+  onewire_rmt_trace_clear();
+  mg_rpc_send_responsef(ri, NULL);
+  (void) cb_arg;
+  (void) fi;
+  (void) args;
+}
+#endif
+
+#if defined(OW_BENCH) && defined(MGOS_HAVE_RPC_COMMON)
+#include "mgos_rpc.h"
+
+static void ow_bench_handler(struct mg_rpc_request_info *ri, void *cb_arg,
+                             struct mg_rpc_frame_info *fi,
+                             struct mg_str args) {
+  int bytes = 100;
+  struct onewire_bench_result res;
+  json_scanf(args.p, args.len, ri->args_fmt, &bytes);
+  if (!onewire_bench_run(bytes, &res)) {
+    mg_rpc_send_errorf(ri, 500, "bench failed");
+  } else {
+    mg_rpc_send_responsef(ri,
+                          "{bytes: %d, virtual: {write_us: %d, read_us: %d}, "
+                          "template: {write_us: %d, read_us: %d}, "
+                          "uart: {write_us: %d, read_us: %d}}",
+                          bytes, res.virt_write_us, res.virt_read_us,
+                          res.tmpl_write_us, res.tmpl_read_us,
+                          res.uart_write_us, res.uart_read_us);
+  }
+  (void) cb_arg;
+  (void) fi;
+}
+#endif
+
 bool mgos_dallas_esp32_init(void) {
-  return true;
+#if defined(MGOS_HAVE_RPC_COMMON) && (defined(OW_TRACE) || defined(OW_BENCH))
+  struct mg_rpc *c = mgos_rpc_get_global();
+  if (c != NULL) {
+#ifdef OW_TRACE
+    mg_rpc_add_handler(c, "OW.TraceDump", "{file: %Q}", ow_trace_dump_handler,
+                       NULL);
+    mg_rpc_add_handler(c, "OW.TraceClear", "", ow_trace_clear_handler, NULL);
+#endif
+#ifdef OW_BENCH
+    mg_rpc_add_handler(c, "OW.Bench", "{bytes: %d}", ow_bench_handler, NULL);
+#endif
+  }
+#endif
+  return mgos_event_register_base(MGOS_DALLAS_ESP32_EV_BASE, "dallas-esp32");
 }
@@ -0,0 +1,75 @@
+#ifdef OW_BENCH
+#include "onewire_bench.h"
+
+#include <mgos.h>
+
+#include "OnewireESP32.h"
+#include "OnewireESP32T.h"
+#include "OnewireESP32Uart.h"
+#include "onewire_bus_lock.h"
+
+#ifndef OW_BENCH_PIN
+#define OW_BENCH_PIN 13
+#endif
+
+#ifndef OW_BENCH_RMT_RX
+#define OW_BENCH_RMT_RX 0
+#endif
+
+#ifndef OW_BENCH_RMT_TX
+#define OW_BENCH_RMT_TX 1
+#endif
+
+#ifndef OW_BENCH_UART
+#define OW_BENCH_UART 2
+#endif
+
+template <class OW>
+static void onewire_bench(OW &ow, int n, int *write_us, int *read_us) {
+  ow.reset();
+  ow.skip();
+  int64_t start = mgos_uptime_micros();
+  for (int i = 0; i < n; ++i) {
+    ow.write(0xFF, 0);  // write 1 slots are harmless on an idle bus
+  }
+  int64_t mid = mgos_uptime_micros();
+  for (int i = 0; i < n; ++i) {
+    ow.read();
+  }
+  int64_t end = mgos_uptime_micros();
+  ow.reset();
+  *write_us = (int) ((mid - start) / n);
+  *read_us = (int) ((end - mid) / n);
+}
+
+bool onewire_bench_run(int bytes, struct onewire_bench_result *res) {
+  if (bytes <= 0 || res == NULL) return false;
+  {
+    OnewireESP32 ow(OW_BENCH_PIN, OW_BENCH_RMT_RX, OW_BENCH_RMT_TX);
+    struct onewire_bus_lock *lock = ow.busLock();
+    if (lock == NULL) return false;
+    OnewireInterface &iface = ow;
+    onewire_bus_lock_take(lock, OW_BUS_LOCK_TASK_PRIO);
+    onewire_bench(iface, bytes, &res->virt_write_us, &res->virt_read_us);
+    onewire_bus_lock_give(lock);
+  }
+  {
+    OnewireESP32T<OW_BENCH_PIN, OW_BENCH_RMT_RX, OW_BENCH_RMT_TX> ow;
+    struct onewire_bus_lock *lock = ow.busLock();
+    if (lock == NULL) return false;
+    onewire_bus_lock_take(lock, OW_BUS_LOCK_TASK_PRIO);
+    onewire_bench(ow, bytes, &res->tmpl_write_us, &res->tmpl_read_us);
+    onewire_bus_lock_give(lock);
+  }
+  {
+    OnewireESP32Uart ow(OW_BENCH_PIN, OW_BENCH_UART);
+    struct onewire_bus_lock *lock = ow.busLock();
+    if (lock == NULL) return false;
+    OnewireInterface &iface = ow;
+    onewire_bus_lock_take(lock, OW_BUS_LOCK_TASK_PRIO);
+    onewire_bench(iface, bytes, &res->uart_write_us, &res->uart_read_us);
+    onewire_bus_lock_give(lock);
+  }
+  return true;
+}
+#endif
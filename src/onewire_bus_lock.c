@@ -0,0 +1,191 @@
+#include <mgos.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "onewire_bus_lock.h"
+
+struct onewire_bus_waiter {
+  TaskHandle_t task;
+  int prio;
+  // arrival order among the waiters
+  uint32_t ticket;
+  // the slot is freed by the waiter itself once woken up
+  bool used;
+  bool granted;
+  SemaphoreHandle_t sem;
+};
+
+struct onewire_bus_lock {
+  // protects the fields below
+  SemaphoreHandle_t mutex;
+  TaskHandle_t owner;
+  int owner_prio;
+  int depth;
+  // counts the changes of the owning task, see onewire_bus_lock_epoch()
+  TaskHandle_t last_owner;
+  uint32_t epoch;
+  uint32_t next_ticket;
+  struct onewire_bus_waiter waiters[OW_BUS_LOCK_MAX_WAITERS];
+};
+
+struct onewire_bus_lock *onewire_bus_lock_create(void) {
+  struct onewire_bus_lock *l =
+      (struct onewire_bus_lock *) calloc(1, sizeof(struct onewire_bus_lock));
+  if (l == NULL) return NULL;
+  l->mutex = xSemaphoreCreateMutex();
+  bool ok = l->mutex != NULL;
+  for (int i = 0; i < OW_BUS_LOCK_MAX_WAITERS && ok; i++) {
+    l->waiters[i].sem = xSemaphoreCreateBinary();
+    ok = l->waiters[i].sem != NULL;
+  }
+  if (!ok) {
+    onewire_bus_lock_delete(l);
+    return NULL;
+  }
+  return l;
+}
+
+void onewire_bus_lock_delete(struct onewire_bus_lock *l) {
+  if (l == NULL) return;
+  for (int i = 0; i < OW_BUS_LOCK_MAX_WAITERS; i++) {
+    if (l->waiters[i].sem != NULL) vSemaphoreDelete(l->waiters[i].sem);
+  }
+  if (l->mutex != NULL) vSemaphoreDelete(l->mutex);
+  free(l);
+}
+
+// highest priority waiter above `min_prio`, the oldest one wins a tie
+static struct onewire_bus_waiter *onewire_bus_lock_best(
+    struct onewire_bus_lock *l, int min_prio) {
+  struct onewire_bus_waiter *best = NULL;
+  for (int i = 0; i < OW_BUS_LOCK_MAX_WAITERS; i++) {
+    struct onewire_bus_waiter *w = &l->waiters[i];
+    if (!w->used || w->granted || w->prio <= min_prio) continue;
+    if (best == NULL || w->prio > best->prio ||
+        (w->prio == best->prio && (int32_t) (w->ticket - best->ticket) < 0)) {
+      best = w;
+    }
+  }
+  return best;
+}
+
+// called with the mutex held
+static void onewire_bus_lock_set_owner(struct onewire_bus_lock *l,
+                                       TaskHandle_t task, int prio) {
+  if (task != l->last_owner) {
+    l->last_owner = task;
+    l->epoch++;
+  }
+  l->owner = task;
+  l->owner_prio = prio;
+  l->depth = 1;
+}
+
+// called with the mutex held
+static void onewire_bus_lock_hand_over(struct onewire_bus_lock *l,
+                                       struct onewire_bus_waiter *w) {
+  onewire_bus_lock_set_owner(l, w->task, w->prio);
+  w->granted = true;
+  xSemaphoreGive(w->sem);
+}
+
+// block until the bus is ours, as a new owner with a depth of 1
+static void onewire_bus_lock_wait(struct onewire_bus_lock *l, int prio) {
+  TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  for (;;) {
+    xSemaphoreTake(l->mutex, portMAX_DELAY);
+    if (l->owner == NULL) {
+      onewire_bus_lock_set_owner(l, me, prio);
+      xSemaphoreGive(l->mutex);
+      return;
+    }
+    struct onewire_bus_waiter *w = NULL;
+    for (int i = 0; i < OW_BUS_LOCK_MAX_WAITERS; i++) {
+      if (!l->waiters[i].used) {
+        w = &l->waiters[i];
+        break;
+      }
+    }
+    if (w == NULL) {
+      // too many waiters, retry later
+      xSemaphoreGive(l->mutex);
+      vTaskDelay(1);
+      continue;
+    }
+    w->task = me;
+    w->prio = prio;
+    w->ticket = l->next_ticket++;
+    w->used = true;
+    w->granted = false;
+    xSemaphoreGive(l->mutex);
+
+    // the giver makes us the owner before waking us up
+    xSemaphoreTake(w->sem, portMAX_DELAY);
+    xSemaphoreTake(l->mutex, portMAX_DELAY);
+    w->used = false;
+    xSemaphoreGive(l->mutex);
+    return;
+  }
+}
+
+void onewire_bus_lock_take(struct onewire_bus_lock *l, int prio) {
+  if (l == NULL) return;
+  if (prio == OW_BUS_LOCK_TASK_PRIO) prio = (int) uxTaskPriorityGet(NULL);
+
+  xSemaphoreTake(l->mutex, portMAX_DELAY);
+  if (l->owner == xTaskGetCurrentTaskHandle()) {
+    l->depth++;
+    xSemaphoreGive(l->mutex);
+    return;
+  }
+  xSemaphoreGive(l->mutex);
+  onewire_bus_lock_wait(l, prio);
+}
+
+void onewire_bus_lock_give(struct onewire_bus_lock *l) {
+  if (l == NULL) return;
+  xSemaphoreTake(l->mutex, portMAX_DELAY);
+  if (l->owner == xTaskGetCurrentTaskHandle() && --l->depth == 0) {
+    struct onewire_bus_waiter *w = onewire_bus_lock_best(l, -1);
+    if (w != NULL) {
+      onewire_bus_lock_hand_over(l, w);
+    } else {
+      l->owner = NULL;
+    }
+  }
+  xSemaphoreGive(l->mutex);
+}
+
+bool onewire_bus_lock_yield(struct onewire_bus_lock *l) {
+  if (l == NULL) return false;
+  xSemaphoreTake(l->mutex, portMAX_DELAY);
+  if (l->owner != xTaskGetCurrentTaskHandle()) {
+    xSemaphoreGive(l->mutex);
+    return false;
+  }
+  struct onewire_bus_waiter *w = onewire_bus_lock_best(l, l->owner_prio);
+  if (w == NULL) {
+    xSemaphoreGive(l->mutex);
+    return false;
+  }
+  int prio = l->owner_prio;
+  int depth = l->depth;
+  onewire_bus_lock_hand_over(l, w);
+  xSemaphoreGive(l->mutex);
+
+  // resume when the more urgent task is done, with the same nesting
+  onewire_bus_lock_wait(l, prio);
+  xSemaphoreTake(l->mutex, portMAX_DELAY);
+  l->depth = depth;
+  xSemaphoreGive(l->mutex);
+  return true;
+}
+
+uint32_t onewire_bus_lock_epoch(struct onewire_bus_lock *l) {
+  if (l == NULL) return 0;
+  xSemaphoreTake(l->mutex, portMAX_DELAY);
+  uint32_t epoch = l->epoch;
+  xSemaphoreGive(l->mutex);
+  return epoch;
+}
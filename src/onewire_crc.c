@@ -0,0 +1,23 @@
+#include "onewire_crc.h"
+
+uint16_t onewire_crc16(uint16_t crc, const uint8_t *data, int len) {
+  static const uint8_t oddparity[16] = {0, 1, 1, 0, 1, 0, 0, 1,
+                                        1, 0, 0, 1, 0, 1, 1, 0};
+
+  for (int i = 0; i < len; i++) {
+    // Even though we're just copying a byte from the input,
+    // we'll be doing 16-bit computation with it.
+    uint16_t cdata = data[i];
+    cdata = (cdata ^ crc) & 0xff;
+    crc >>= 8;
+
+    if (oddparity[cdata & 0x0F] ^ oddparity[cdata >> 4]) crc ^= 0xC001;
+
+    cdata <<= 6;
+    crc ^= cdata;
+    cdata <<= 1;
+    crc ^= cdata;
+  }
+
+  return crc;
+}
@@ -64,7 +64,9 @@ sample code bearing this copyright.
 
 #include "driver/gpio.h"
 #include "driver/rmt.h"
+#include "onewire_bus_lock.h"
 #include "onewire_rmt.h"
+#include "onewire_rmt_trace.h"
 
 // *****************************************************************************
 // Onewire platform interface
@@ -85,6 +87,17 @@ sample code bearing this copyright.
 // needs to be larger than any duration occurring during write slots
 #define OW_DURATION_RX_IDLE (OW_DURATION_SLOT + 2)
 
+// number of RMT memory blocks (64 items each) used by the RX channel.
+// Increasing it makes longer chunks possible per RMT round trip but
+// borrows the memory of the following channel(s), which must stay unused.
+#ifndef OW_RMT_RX_MEM_BLOCKS
+#define OW_RMT_RX_MEM_BLOCKS 1
+#endif
+// RX items which fit into the channel memory, one is kept for the idle marker
+#define OW_RX_ITEMS_MAX (OW_RMT_RX_MEM_BLOCKS * 64 - 1)
+// bytes read per RMT round trip by the chunked read, 7 with one block
+#define OW_STREAM_CHUNK_BYTES (OW_RX_ITEMS_MAX / 8)
+
 // Strong pull-up aka power mode is implemented by the pad's push-pull driver.
 // Open-drain configuration is used for normal operation.
 // power bus by disabling open-drain:
@@ -98,7 +111,13 @@ static struct {
   int tx, rx;
   RingbufHandle_t rb;
   int gpio;
-} ow_rmt = {-1, -1, NULL, -1};
+  // number of buses sharing the channels
+  int refs;
+  // pins whose pad has already been configured for the RMT channels
+  uint64_t pins;
+  // arbitration of the channels between the tasks using any of the buses
+  struct onewire_bus_lock *lock;
+} ow_rmt = {-1, -1, NULL, -1, 0, 0, NULL};
 
 // default power mode for generic write operations
 static const uint8_t owDefaultPower = 0;
@@ -130,13 +149,14 @@ static bool onewire_rmt_init(int gpio_num, int rx_channel, int tx_channel) {
       rmt_rx.channel = ow_rmt.rx;
       rmt_rx.gpio_num = gpio_num;
       rmt_rx.clk_div = 80;
-      rmt_rx.mem_block_num = 1;
+      rmt_rx.mem_block_num = OW_RMT_RX_MEM_BLOCKS;
       rmt_rx.rmt_mode = RMT_MODE_RX;
       rmt_rx.rx_config.filter_en = true;
       rmt_rx.rx_config.filter_ticks_thresh = 30;
       rmt_rx.rx_config.idle_threshold = OW_DURATION_RX_IDLE;
       if (rmt_config(&rmt_rx) == ESP_OK) {
-        if (rmt_driver_install(rmt_rx.channel, 512,
+        if (rmt_driver_install(rmt_rx.channel,
+                               2 * (OW_RX_ITEMS_MAX + 1) * sizeof(rmt_item32_t),
                                ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_IRAM |
                                    ESP_INTR_FLAG_SHARED) == ESP_OK) {
           rmt_get_ringbuf_handle(ow_rmt.rx, &ow_rmt.rb);
@@ -173,23 +193,37 @@ static bool onewire_rmt_attach_pin(int gpio_num) {
   if (ow_rmt.tx < 0 || ow_rmt.rx < 0) return false;
 
   if (gpio_num != ow_rmt.gpio) {
-    // attach GPIO to previous pin
+    // enable the output of the new pin
     if (gpio_num < 32) {
       GPIO.enable_w1ts = (0x1 << gpio_num);
     } else {
       GPIO.enable1_w1ts.data = (0x1 << (gpio_num - 32));
     }
     if (ow_rmt.gpio >= 0) {
+      // release the previous pin: open-drain GPIO output driving high
+      OW_DEPOWER(ow_rmt.gpio);
+      if (ow_rmt.gpio < 32) {
+        GPIO.out_w1ts = (0x1 << ow_rmt.gpio);
+      } else {
+        GPIO.out1_w1ts.data = (0x1 << (ow_rmt.gpio - 32));
+      }
       gpio_matrix_out(ow_rmt.gpio, SIG_GPIO_OUT_IDX, 0, 0);
     }
 
-    // attach RMT channels to new gpio pin
-    // ATTENTION: set pin for rx first since gpio_output_disable() will
-    //            remove rmt output signal in matrix!
-    rmt_set_pin(ow_rmt.rx, RMT_MODE_RX, gpio_num);
-    rmt_set_pin(ow_rmt.tx, RMT_MODE_TX, gpio_num);
-    // force pin direction to input to enable path to RX channel
-    PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[gpio_num]);
+    if (ow_rmt.pins & (1ULL << gpio_num)) {
+      // pad already configured, only route the RMT signals
+      gpio_matrix_in(gpio_num, RMT_SIG_IN0_IDX + ow_rmt.rx, 0);
+      gpio_matrix_out(gpio_num, RMT_SIG_OUT0_IDX + ow_rmt.tx, 0, 0);
+    } else {
+      // attach RMT channels to new gpio pin
+      // ATTENTION: set pin for rx first since gpio_output_disable() will
+      //            remove rmt output signal in matrix!
+      rmt_set_pin(ow_rmt.rx, RMT_MODE_RX, gpio_num);
+      rmt_set_pin(ow_rmt.tx, RMT_MODE_TX, gpio_num);
+      // force pin direction to input to enable path to RX channel
+      PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[gpio_num]);
+      ow_rmt.pins |= (1ULL << gpio_num);
+    }
 
     ow_rmt.gpio = gpio_num;
   }
@@ -244,6 +278,8 @@ static bool onewire_write_bits(uint8_t gpio_num, uint8_t data, uint8_t num,
   tx_items[num].level0 = 1;
   tx_items[num].duration0 = 0;
 
+  onewire_rmt_trace_frame(OW_TRACE_TX, gpio_num, onewire_rmt_trace_time(),
+                          tx_items, num);
   if (rmt_write_items(ow_rmt.tx, tx_items, num + 1, true) == ESP_OK) {
     return true;
   } else {
@@ -288,12 +324,16 @@ static bool onewire_read_bits(uint8_t gpio_num, uint8_t *data, uint8_t num) {
 
   onewire_flush_rmt_rx_buf();
   rmt_rx_start(ow_rmt.rx, true);
+  uint32_t trace_time = onewire_rmt_trace_time();
+  onewire_rmt_trace_frame(OW_TRACE_TX, gpio_num, trace_time, tx_items, num);
   if (rmt_write_items(ow_rmt.tx, tx_items, num + 1, true) == ESP_OK) {
     size_t rx_size;
     rmt_item32_t *rx_items =
         (rmt_item32_t *) xRingbufferReceive(ow_rmt.rb, &rx_size, portMAX_DELAY);
 
     if (rx_items) {
+      onewire_rmt_trace_frame(OW_TRACE_RX, gpio_num, trace_time, rx_items,
+                              rx_size / sizeof(rmt_item32_t));
 #ifdef OW_DEBUG
       for (int i = 0; i < rx_size / 4; i++) {
         ESP_LOGI("ow", "level: %d, duration %d", rx_items[i].level0,
@@ -334,6 +374,83 @@ static bool onewire_read_bits(uint8_t gpio_num, uint8_t *data, uint8_t num) {
   return res;
 }
 
+// Read `len` bytes in chunks of OW_STREAM_CHUNK_BYTES: the read slots of a
+// whole chunk fit into the RX channel memory, they are sent at once and the
+// RX ringbuffer is drained once per chunk, i.e. one RMT round trip per chunk.
+static bool onewire_read_stream(uint8_t gpio_num, uint8_t *buf, int len) {
+  rmt_item32_t tx_items[OW_STREAM_CHUNK_BYTES * 8 + 1];
+  bool res = true;
+
+  if (onewire_rmt_attach_pin(gpio_num) != true) {
+    return false;
+  }
+
+  OW_DEPOWER(gpio_num);
+
+  for (int i = 0; i < OW_STREAM_CHUNK_BYTES * 8; i++) {
+    tx_items[i] = onewire_encode_read_slot();
+  }
+
+  while (len > 0 && res) {
+    int chunk = len < OW_STREAM_CHUNK_BYTES ? len : OW_STREAM_CHUNK_BYTES;
+    int num = chunk * 8;
+
+    // end marker
+    tx_items[num].level0 = 1;
+    tx_items[num].duration0 = 0;
+
+    onewire_flush_rmt_rx_buf();
+    rmt_rx_start(ow_rmt.rx, true);
+    uint32_t trace_time = onewire_rmt_trace_time();
+    onewire_rmt_trace_frame(OW_TRACE_TX, gpio_num, trace_time, tx_items, num);
+    if (rmt_write_items(ow_rmt.tx, tx_items, num + 1, true) == ESP_OK) {
+      size_t rx_size;
+      rmt_item32_t *rx_items = (rmt_item32_t *) xRingbufferReceive(
+          ow_rmt.rb, &rx_size, 100 / portTICK_PERIOD_MS);
+
+      if (rx_items) {
+        onewire_rmt_trace_frame(OW_TRACE_RX, gpio_num, trace_time, rx_items,
+                                rx_size / sizeof(rmt_item32_t));
+        if (rx_size >= num * sizeof(rmt_item32_t)) {
+          const rmt_item32_t *item = rx_items;
+          for (int b = 0; b < chunk; b++) {
+            uint8_t read_data = 0;
+            for (int i = 0; i < 8; i++, item++) {
+              read_data >>= 1;
+              // rising edge occured before 15us -> bit 1
+              if ((item->level1 == 1) && (item->level0 == 0) &&
+                  (item->duration0 < OW_DURATION_SAMPLE)) {
+                read_data |= 0x80;
+              }
+            }
+            buf[b] = read_data;
+          }
+        } else {
+          res = false;
+        }
+        vRingbufferReturnItem(ow_rmt.rb, (void *) rx_items);
+      } else {
+        // time out occurred, this indicates an unconnected / misconfigured bus
+        res = false;
+      }
+    } else {
+      // error in tx channel
+      res = false;
+    }
+
+    rmt_rx_stop(ow_rmt.rx);
+
+    // restore the read slot overwritten by the end marker
+    if (num < OW_STREAM_CHUNK_BYTES * 8) {
+      tx_items[num] = onewire_encode_read_slot();
+    }
+    buf += chunk;
+    len -= chunk;
+  }
+
+  return res;
+}
+
 struct onewire_search_state {
   int search_mode;
   int last_device;
@@ -358,8 +475,15 @@ struct mgos_rmt_onewire {
   platform_onewire_bus_t sst;
   int rmt_rx;
   int rmt_tx;
+  // only device on the bus, selected with Skip ROM instead of MATCH ROM
+  bool single;
+  uint8_t single_rom[8];
 };
 
+bool onewire_rmt_attach(struct mgos_rmt_onewire *ow) {
+  return onewire_rmt_attach_pin(ow->pin);
+}
+
 struct mgos_rmt_onewire *onewire_rmt_create(int pin, int rmt_rx, int rmt_tx) {
   int rx = rmt_rx;  // mgos_sys_config_get_onewire_rmt_rx_channel();
   int tx = rmt_tx;  // mgos_sys_config_get_onewire_rmt_tx_channel();
@@ -368,12 +492,25 @@ struct mgos_rmt_onewire *onewire_rmt_create(int pin, int rmt_rx, int rmt_tx) {
         ("onewire_rmt could not start - rx and/or tx channel not set."));
     return NULL;
   }
-  bool driverOk = onewire_rmt_init(pin, rx, tx);
-  if (false == driverOk) {
-    LOG(LL_INFO,
-        ("onewire_rmt could not start - rmt device could not be configured."));
-    return NULL;
+  if (ow_rmt.refs > 0) {
+    // the channels are already installed, buses on other pins share them
+    if (rx != ow_rmt.rx || tx != ow_rmt.tx) {
+      LOG(LL_INFO, ("onewire_rmt could not start - only one RMT channel pair "
+                    "(rx=%d, tx=%d) is supported.",
+                    ow_rmt.rx, ow_rmt.tx));
+      return NULL;
+    }
+  } else {
+    bool driverOk = onewire_rmt_init(pin, rx, tx);
+    if (false == driverOk) {
+      LOG(LL_INFO,
+          ("onewire_rmt could not start - rmt device could not be "
+           "configured."));
+      return NULL;
+    }
+    ow_rmt.lock = onewire_bus_lock_create();
   }
+  ow_rmt.refs++;
   struct mgos_rmt_onewire *ow =
       (struct mgos_rmt_onewire *) calloc(1, sizeof(struct mgos_rmt_onewire));
   ow->pin = pin;
@@ -384,18 +521,27 @@ struct mgos_rmt_onewire *onewire_rmt_create(int pin, int rmt_rx, int rmt_tx) {
 
 void onewire_rmt_close(struct mgos_rmt_onewire *ow) {
   if (NULL != ow) {
-    /*esp_err_t resRx =*/rmt_driver_uninstall(ow->rmt_rx);
-    /*esp_err_t resTx =*/rmt_driver_uninstall(ow->rmt_tx);
     free((void *) ow);
+    if (--ow_rmt.refs > 0) return;
+    /*esp_err_t resRx =*/rmt_driver_uninstall(ow_rmt.rx);
+    /*esp_err_t resTx =*/rmt_driver_uninstall(ow_rmt.tx);
     ow_rmt.tx = -1;
     ow_rmt.rx = -1;
     ow_rmt.rb = NULL;
     ow_rmt.gpio = -1;
+    ow_rmt.pins = 0;
+    onewire_bus_lock_delete(ow_rmt.lock);
+    ow_rmt.lock = NULL;
     // LOG(LL_INFO, ("CLOSE onewire_rmt: resRx=%d, resTx=%d", (int) resRx, (int)
     // resTx));
   }
 }
 
+struct onewire_bus_lock *onewire_rmt_bus_lock(struct mgos_rmt_onewire *ow) {
+  (void) ow;
+  return ow_rmt.lock;
+}
+
 bool onewire_rmt_reset(struct mgos_rmt_onewire *ow) {
   (void) ow;
   rmt_item32_t tx_items[1];
@@ -403,6 +549,11 @@ bool onewire_rmt_reset(struct mgos_rmt_onewire *ow) {
   int res = true;
   int gpio_num = ow->pin;
 
+  // a reset starts a new transaction, let a more urgent task use the bus;
+  // it may search this bus too, resume our search where it stopped
+  platform_onewire_bus_t sst = ow->sst;
+  if (onewire_bus_lock_yield(ow_rmt.lock)) ow->sst = sst;
+
   if (onewire_rmt_attach_pin(gpio_num) != true) return false;
 
   OW_DEPOWER(gpio_num);
@@ -418,12 +569,16 @@ bool onewire_rmt_reset(struct mgos_rmt_onewire *ow) {
 
   onewire_flush_rmt_rx_buf();
   rmt_rx_start(ow_rmt.rx, true);
+  uint32_t trace_time = onewire_rmt_trace_time();
+  onewire_rmt_trace_frame(OW_TRACE_TX, gpio_num, trace_time, tx_items, 1);
   if (rmt_write_items(ow_rmt.tx, tx_items, 1, true) == ESP_OK) {
     size_t rx_size;
     rmt_item32_t *rx_items = (rmt_item32_t *) xRingbufferReceive(
         ow_rmt.rb, &rx_size, 100 / portTICK_PERIOD_MS);
 
     if (rx_items) {
+      onewire_rmt_trace_frame(OW_TRACE_RX, gpio_num, trace_time, rx_items,
+                              rx_size / sizeof(rmt_item32_t));
       if (rx_size >= 1 * sizeof(rmt_item32_t)) {
 #ifdef OW_DEBUG
         for (int i = 0; i < rx_size / 4; i++) {
@@ -530,8 +685,20 @@ void onewire_rmt_target_setup(struct mgos_rmt_onewire *ow,
 //        false : device not found, end of search
 //
 
+// a search from the start tells whether the first device is the only one
+static void onewire_rmt_single_update(struct mgos_rmt_onewire *ow, bool found,
+                                      const uint8_t *rom) {
+  if (found && ow->sst.LastDeviceFlag) {
+    memcpy(ow->single_rom, rom, sizeof(ow->single_rom));
+    ow->single = true;
+  } else {
+    ow->single = false;
+  }
+}
+
 bool onewire_rmt_next(struct mgos_rmt_onewire *ow, uint8_t *rom, int mode) {
   (void) mode;
+  bool from_start = ow->sst.LastDiscrepancy == 0 && !ow->sst.LastDeviceFlag;
   uint8_t id_bit_number;
   uint8_t last_zero, rom_byte_number, search_result;
   uint8_t id_bit, cmp_id_bit;
@@ -554,6 +721,7 @@ bool onewire_rmt_next(struct mgos_rmt_onewire *ow, uint8_t *rom, int mode) {
       ow->sst.LastDiscrepancy = 0;
       ow->sst.LastDeviceFlag = false;
       ow->sst.LastFamilyDiscrepancy = 0;
+      if (from_start) ow->single = false;
       return false;
     }
 
@@ -649,10 +817,16 @@ bool onewire_rmt_next(struct mgos_rmt_onewire *ow, uint8_t *rom, int mode) {
       rom[rom_byte_number] = ow->sst.ROM_NO[rom_byte_number];
     }
   }
+  if (from_start) onewire_rmt_single_update(ow, search_result, rom);
   return search_result;
 }
 
 void onewire_rmt_select(struct mgos_rmt_onewire *ow, const uint8_t *rom) {
+  if (ow->single && memcmp(rom, ow->single_rom, 8) == 0) {
+    // 8 write slots instead of 72
+    onewire_rmt_skip(ow);
+    return;
+  }
   // onewire_write(ow, 0x55);
   onewire_write_bits(ow->pin, 0x55, 8, owDefaultPower);
   for (int i = 0; i < 8; i++) {
@@ -670,6 +844,19 @@ void onewire_rmt_search_clean(struct mgos_rmt_onewire *ow) {
   memset(&ow->sst, 0, sizeof(ow->sst));
 }
 
+void onewire_rmt_set_single(struct mgos_rmt_onewire *ow, const uint8_t *rom) {
+  ow->single = rom != NULL;
+  if (rom == NULL) return;
+  memcpy(ow->single_rom, rom, sizeof(ow->single_rom));
+}
+
+bool onewire_rmt_get_single(struct mgos_rmt_onewire *ow, uint8_t *rom) {
+  if (ow->single && rom != NULL) {
+    memcpy(rom, ow->single_rom, sizeof(ow->single_rom));
+  }
+  return ow->single;
+}
+
 bool onewire_rmt_read_bit(struct mgos_rmt_onewire *ow) {
   uint8_t bit = 0;
   if (onewire_read_bits(ow->pin, &bit, 1)) {
@@ -686,14 +873,9 @@ uint8_t onewire_rmt_read(struct mgos_rmt_onewire *ow) {
   return res;
 }
 
-void onewire_rmt_read_bytes(struct mgos_rmt_onewire *ow, uint8_t *buf,
+bool onewire_rmt_read_bytes(struct mgos_rmt_onewire *ow, uint8_t *buf,
                             int len) {
-  for (uint16_t i = 0; i < len; i++) {
-    if (onewire_read_bits(ow->pin, buf, 8) != true) {
-      return;  // PLATFORM_ERR;
-    }
-    buf++;
-  }
+  return onewire_read_stream(ow->pin, buf, len);
 }
 
 void onewire_rmt_write_bit(struct mgos_rmt_onewire *ow, int bit) {
@@ -705,6 +887,15 @@ void onewire_rmt_write(struct mgos_rmt_onewire *ow, const uint8_t data) {
   onewire_write_bits(ow->pin, data, 8, owDefaultPower);
 }
 
+void onewire_rmt_write_power(struct mgos_rmt_onewire *ow, const uint8_t data,
+                             bool power) {
+  onewire_write_bits(ow->pin, data, 8, power);
+}
+
+void onewire_rmt_depower(struct mgos_rmt_onewire *ow) {
+  OW_DEPOWER(ow->pin);
+}
+
 void onewire_rmt_write_bytes(struct mgos_rmt_onewire *ow, const uint8_t *buf,
                              int len) {
   for (uint16_t i = 0; i < len; i++) {
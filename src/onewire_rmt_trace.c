@@ -0,0 +1,93 @@
+#include <mgos.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "onewire_rmt_trace.h"
+
+#ifdef OW_TRACE
+
+// the ring is shared by the RMT buses of all the tasks and cores, and
+// dumped from the mgos task: the fields below are protected by ow_trace_mux
+static portMUX_TYPE ow_trace_mux = portMUX_INITIALIZER_UNLOCKED;
+static struct onewire_rmt_trace_record ow_trace[OW_TRACE_RECORDS];
+// number of records written since the last clear
+static uint32_t ow_trace_head = 0;
+static bool ow_trace_enabled = true;
+
+void onewire_rmt_trace_enable(bool enable) {
+  portENTER_CRITICAL(&ow_trace_mux);
+  ow_trace_enabled = enable;
+  portEXIT_CRITICAL(&ow_trace_mux);
+}
+
+void onewire_rmt_trace_clear(void) {
+  portENTER_CRITICAL(&ow_trace_mux);
+  ow_trace_head = 0;
+  portEXIT_CRITICAL(&ow_trace_mux);
+}
+
+uint32_t onewire_rmt_trace_time(void) {
+  return (uint32_t) esp_timer_get_time();
+}
+
+void onewire_rmt_trace_frame(uint8_t type, uint8_t gpio, uint32_t time,
+                             const void *items, int num) {
+  const uint32_t *item = (const uint32_t *) items;
+  portENTER_CRITICAL(&ow_trace_mux);
+  for (int i = 0; ow_trace_enabled && i < num; i++) {
+    struct onewire_rmt_trace_record *r =
+        &ow_trace[ow_trace_head++ % OW_TRACE_RECORDS];
+    r->time = time;
+    r->type = type;
+    r->gpio = gpio;
+    r->index = i;
+    r->item = item[i];
+  }
+  portEXIT_CRITICAL(&ow_trace_mux);
+}
+
+int onewire_rmt_trace_dump(const char *path) {
+  // snapshot the ring, oldest first, the tracing goes on meanwhile
+  struct onewire_rmt_trace_record *records =
+      (struct onewire_rmt_trace_record *) malloc(sizeof(ow_trace));
+  if (records == NULL) {
+    LOG(LL_ERROR, ("Out of memory"));
+    return -1;
+  }
+  portENTER_CRITICAL(&ow_trace_mux);
+  uint32_t count =
+      ow_trace_head < OW_TRACE_RECORDS ? ow_trace_head : OW_TRACE_RECORDS;
+  uint32_t first = (ow_trace_head - count) % OW_TRACE_RECORDS;
+  uint32_t tail = count < OW_TRACE_RECORDS - first ? count
+                                                   : OW_TRACE_RECORDS - first;
+  memcpy(records, &ow_trace[first], tail * sizeof(*records));
+  memcpy(&records[tail], ow_trace, (count - tail) * sizeof(*records));
+  portEXIT_CRITICAL(&ow_trace_mux);
+
+  FILE *fp = fopen(path, "wb");
+  if (fp == NULL) {
+    LOG(LL_ERROR, ("Failed to open %s", path));
+    free(records);
+    return -1;
+  }
+
+  struct onewire_rmt_trace_header hdr;
+  memcpy(hdr.magic, OW_TRACE_MAGIC, sizeof(hdr.magic));
+  hdr.version = OW_TRACE_VERSION;
+  hdr.record_size = sizeof(struct onewire_rmt_trace_record);
+  hdr.count = count;
+  hdr.reserved = 0;
+
+  int res = count;
+  if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+      fwrite(records, sizeof(*records), count, fp) != count) {
+    res = -1;
+  }
+  fclose(fp);
+  free(records);
+
+  LOG(LL_INFO, ("Trace: %d records written to %s", res, path));
+  return res;
+}
+
+#endif
@@ -0,0 +1,335 @@
+#include <mgos.h>
+#include <stdbool.h>
+
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "onewire_bus_lock.h"
+#include "onewire_uart.h"
+#include "soc/gpio_sig_map.h"
+
+// baud rate of the data slots: 1 UART bit = 8.7us, start bit = write 1 slot
+#define OW_UART_BAUD_DATA 115200
+// baud rate of the reset: start bit + 4 bits low = 520us
+#define OW_UART_BAUD_RESET 9600
+// UART byte sent for the reset, changed by the presence pulse
+#define OW_UART_RESET 0xF0
+// UART bytes of the write 1 / read slot and of the write 0 slot
+#define OW_UART_SLOT_1 0xFF
+#define OW_UART_SLOT_0 0x00
+// 1-Wire bytes per FIFO transfer (8 slots each), fits the 128 bytes FIFO
+#define OW_UART_CHUNK_BYTES 16
+// timeout of a transfer
+#define OW_UART_TIMEOUT_MS 100
+
+static const int ow_uart_tx_sig[] = {U0TXD_OUT_IDX, U1TXD_OUT_IDX,
+                                     U2TXD_OUT_IDX};
+static const int ow_uart_rx_sig[] = {U0RXD_IN_IDX, U1RXD_IN_IDX, U2RXD_IN_IDX};
+
+typedef struct {
+  uint8_t LastDeviceFlag;
+  uint8_t LastDiscrepancy;
+  uint8_t LastFamilyDiscrepancy;
+  unsigned char ROM_NO[8];
+} platform_onewire_bus_t;
+
+struct mgos_uart_onewire {
+  int pin;
+  int uart;
+  platform_onewire_bus_t sst;
+  struct onewire_bus_lock *lock;
+  // only device on the bus, selected with Skip ROM instead of MATCH ROM
+  bool single;
+  uint8_t single_rom[8];
+};
+
+// send `len` slot bytes and read back what the bus looked like
+static bool onewire_uart_transfer(struct mgos_uart_onewire *ow,
+                                  const uint8_t *tx, uint8_t *rx, int len) {
+  // open-drain, drops a strong pull-up left by onewire_uart_write_power()
+  GPIO.pin[ow->pin].pad_driver = 1;
+  uart_flush_input(ow->uart);
+  if (uart_write_bytes(ow->uart, (const char *) tx, len) != len) {
+    return false;
+  }
+  return uart_read_bytes(ow->uart, rx, len,
+                         OW_UART_TIMEOUT_MS / portTICK_PERIOD_MS) == len;
+}
+
+struct mgos_uart_onewire *onewire_uart_create(int pin, int uart_num) {
+  if (uart_num < 0 || uart_num > 2) {
+    LOG(LL_INFO, ("onewire_uart could not start - invalid UART %d.", uart_num));
+    return NULL;
+  }
+  uart_config_t cfg = {
+      .baud_rate = OW_UART_BAUD_DATA,
+      .data_bits = UART_DATA_8_BITS,
+      .parity = UART_PARITY_DISABLE,
+      .stop_bits = UART_STOP_BITS_1,
+      .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+  };
+  if (uart_param_config(uart_num, &cfg) != ESP_OK ||
+      uart_driver_install(uart_num, 256, 0, 0, NULL, 0) != ESP_OK) {
+    LOG(LL_INFO,
+        ("onewire_uart could not start - UART %d could not be configured.",
+         uart_num));
+    return NULL;
+  }
+
+  // TX open-drain and RX on the same pin
+  gpio_pad_select_gpio(pin);
+  gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+  gpio_matrix_out(pin, ow_uart_tx_sig[uart_num], 0, 0);
+  gpio_matrix_in(pin, ow_uart_rx_sig[uart_num], 0);
+  LOG(LL_INFO, ("onewire_uart: pin %d, UART %d", pin, uart_num));
+
+  struct mgos_uart_onewire *ow =
+      (struct mgos_uart_onewire *) calloc(1, sizeof(struct mgos_uart_onewire));
+  ow->pin = pin;
+  ow->uart = uart_num;
+  ow->lock = onewire_bus_lock_create();
+  return ow;
+}
+
+void onewire_uart_close(struct mgos_uart_onewire *ow) {
+  if (NULL != ow) {
+    gpio_matrix_out(ow->pin, SIG_GPIO_OUT_IDX, 0, 0);
+    uart_driver_delete(ow->uart);
+    onewire_bus_lock_delete(ow->lock);
+    free((void *) ow);
+  }
+}
+
+struct onewire_bus_lock *onewire_uart_bus_lock(struct mgos_uart_onewire *ow) {
+  return ow->lock;
+}
+
+bool onewire_uart_reset(struct mgos_uart_onewire *ow) {
+  uint8_t tx = OW_UART_RESET, rx = OW_UART_RESET;
+  bool ok;
+
+  // a reset starts a new transaction, let a more urgent task use the bus;
+  // it may search this bus too, resume our search where it stopped
+  platform_onewire_bus_t sst = ow->sst;
+  if (onewire_bus_lock_yield(ow->lock)) ow->sst = sst;
+
+  uart_set_baudrate(ow->uart, OW_UART_BAUD_RESET);
+  ok = onewire_uart_transfer(ow, &tx, &rx, 1);
+  uart_set_baudrate(ow->uart, OW_UART_BAUD_DATA);
+
+  // a presence pulse pulls some of the high bits low, 0x00 means a shorted bus
+  return ok && rx != OW_UART_RESET && rx != 0x00;
+}
+
+// transfer up to 8 * OW_UART_CHUNK_BYTES slots, LSB first
+static bool onewire_uart_bits(struct mgos_uart_onewire *ow, const uint8_t *out,
+                              uint8_t *in, int num_bits) {
+  uint8_t tx[OW_UART_CHUNK_BYTES * 8], rx[OW_UART_CHUNK_BYTES * 8];
+
+  for (int i = 0; i < num_bits; i++) {
+    tx[i] = (out[i / 8] >> (i % 8)) & 0x01 ? OW_UART_SLOT_1 : OW_UART_SLOT_0;
+  }
+  if (!onewire_uart_transfer(ow, tx, rx, num_bits)) {
+    return false;
+  }
+  if (in != NULL) {
+    memset(in, 0, (num_bits + 7) / 8);
+    for (int i = 0; i < num_bits; i++) {
+      // the bus stayed high for the whole byte -> bit 1
+      if (rx[i] == OW_UART_SLOT_1) in[i / 8] |= 1 << (i % 8);
+    }
+  }
+  return true;
+}
+
+static bool onewire_uart_xfer_bytes(struct mgos_uart_onewire *ow,
+                                    const uint8_t *out, uint8_t *in, int len) {
+  while (len > 0) {
+    int chunk = len < OW_UART_CHUNK_BYTES ? len : OW_UART_CHUNK_BYTES;
+    if (!onewire_uart_bits(ow, out, in, chunk * 8)) {
+      return false;
+    }
+    out += chunk;
+    if (in != NULL) in += chunk;
+    len -= chunk;
+  }
+  return true;
+}
+
+void onewire_uart_target_setup(struct mgos_uart_onewire *ow,
+                               const uint8_t family_code) {
+  ow->sst.ROM_NO[0] = family_code;
+  memset(&ow->sst.ROM_NO[1], 0, 7);
+  ow->sst.LastDiscrepancy = 64;
+  ow->sst.LastFamilyDiscrepancy = 0;
+  ow->sst.LastDeviceFlag = false;
+}
+
+// Same search algorithm as onewire_rmt_next(), the bit and its complement
+// are read in one transfer.
+bool onewire_uart_next(struct mgos_uart_onewire *ow, uint8_t *rom, int mode) {
+  (void) mode;
+  bool from_start = ow->sst.LastDiscrepancy == 0 && !ow->sst.LastDeviceFlag;
+  uint8_t id_bit_number = 1, last_zero = 0, rom_byte_number = 0;
+  uint8_t rom_byte_mask = 1, search_direction;
+  bool search_result = false;
+
+  if (!ow->sst.LastDeviceFlag) {
+    if (onewire_uart_reset(ow) != true) {
+      onewire_uart_search_clean(ow);
+      if (from_start) ow->single = false;
+      return false;
+    }
+    onewire_uart_write(ow, 0xF0);
+
+    do {
+      const uint8_t read_slots = 0x03;
+      uint8_t bits;
+      if (!onewire_uart_bits(ow, &read_slots, &bits, 2)) break;
+      uint8_t id_bit = bits & 0x01, cmp_id_bit = (bits >> 1) & 0x01;
+
+      // no devices on 1-wire
+      if (id_bit && cmp_id_bit) break;
+
+      if (id_bit != cmp_id_bit) {
+        search_direction = id_bit;
+      } else {
+        if (id_bit_number < ow->sst.LastDiscrepancy) {
+          search_direction =
+              ((ow->sst.ROM_NO[rom_byte_number] & rom_byte_mask) > 0);
+        } else {
+          search_direction = (id_bit_number == ow->sst.LastDiscrepancy);
+        }
+        if (search_direction == 0) {
+          last_zero = id_bit_number;
+          if (last_zero < 9) ow->sst.LastFamilyDiscrepancy = last_zero;
+        }
+      }
+
+      if (search_direction == 1) {
+        ow->sst.ROM_NO[rom_byte_number] |= rom_byte_mask;
+      } else {
+        ow->sst.ROM_NO[rom_byte_number] &= ~rom_byte_mask;
+      }
+      onewire_uart_write_bit(ow, search_direction);
+
+      id_bit_number++;
+      rom_byte_mask <<= 1;
+      if (rom_byte_mask == 0) {
+        rom_byte_number++;
+        rom_byte_mask = 1;
+      }
+    } while (rom_byte_number < 8);
+
+    if (!(id_bit_number < 65)) {
+      ow->sst.LastDiscrepancy = last_zero;
+      if (ow->sst.LastDiscrepancy == 0) ow->sst.LastDeviceFlag = true;
+      search_result = true;
+    }
+  }
+
+  if (!search_result || !ow->sst.ROM_NO[0]) {
+    onewire_uart_search_clean(ow);
+    if (from_start) ow->single = false;
+    return false;
+  }
+  memcpy(rom, ow->sst.ROM_NO, 8);
+  // a search from the start tells whether the first device is the only one
+  if (from_start) {
+    if (ow->sst.LastDeviceFlag) {
+      onewire_uart_set_single(ow, rom);
+    } else {
+      ow->single = false;
+    }
+  }
+  return true;
+}
+
+void onewire_uart_select(struct mgos_uart_onewire *ow, const uint8_t *rom) {
+  if (ow->single && memcmp(rom, ow->single_rom, 8) == 0) {
+    onewire_uart_skip(ow);
+    return;
+  }
+  uint8_t buf[9];
+  buf[0] = 0x55;
+  memcpy(&buf[1], rom, 8);
+  onewire_uart_xfer_bytes(ow, buf, NULL, sizeof(buf));
+}
+
+void onewire_uart_skip(struct mgos_uart_onewire *ow) {
+  onewire_uart_write(ow, 0xCC);
+}
+
+void onewire_uart_search_clean(struct mgos_uart_onewire *ow) {
+  memset(&ow->sst, 0, sizeof(ow->sst));
+}
+
+void onewire_uart_set_single(struct mgos_uart_onewire *ow, const uint8_t *rom) {
+  ow->single = rom != NULL;
+  if (rom == NULL) return;
+  memcpy(ow->single_rom, rom, sizeof(ow->single_rom));
+}
+
+bool onewire_uart_get_single(struct mgos_uart_onewire *ow, uint8_t *rom) {
+  if (ow->single && rom != NULL) {
+    memcpy(rom, ow->single_rom, sizeof(ow->single_rom));
+  }
+  return ow->single;
+}
+
+bool onewire_uart_read_bit(struct mgos_uart_onewire *ow) {
+  const uint8_t out = 0x01;
+  uint8_t bit = 0;
+  if (onewire_uart_bits(ow, &out, &bit, 1)) {
+    return bit & 0x01;
+  }
+  return false;
+}
+
+uint8_t onewire_uart_read(struct mgos_uart_onewire *ow) {
+  uint8_t res = 0;
+  onewire_uart_read_bytes(ow, &res, 1);
+  return res;
+}
+
+bool onewire_uart_read_bytes(struct mgos_uart_onewire *ow, uint8_t *buf,
+                             int len) {
+  uint8_t ones[OW_UART_CHUNK_BYTES];
+  memset(ones, 0xFF, sizeof(ones));
+  while (len > 0) {
+    int chunk = len < OW_UART_CHUNK_BYTES ? len : OW_UART_CHUNK_BYTES;
+    if (!onewire_uart_bits(ow, ones, buf, chunk * 8)) {
+      return false;
+    }
+    buf += chunk;
+    len -= chunk;
+  }
+  return true;
+}
+
+void onewire_uart_write_bit(struct mgos_uart_onewire *ow, int bit) {
+  uint8_t data = 0x01 & bit;
+  onewire_uart_bits(ow, &data, NULL, 1);
+}
+
+void onewire_uart_write(struct mgos_uart_onewire *ow, const uint8_t data) {
+  onewire_uart_xfer_bytes(ow, &data, NULL, 1);
+}
+
+void onewire_uart_write_power(struct mgos_uart_onewire *ow, const uint8_t data,
+                              bool power) {
+  onewire_uart_xfer_bytes(ow, &data, NULL, 1);
+  if (power) {
+    // the idle UART TX is high, push-pull makes it a strong pull-up
+    GPIO.pin[ow->pin].pad_driver = 0;
+  }
+}
+
+void onewire_uart_depower(struct mgos_uart_onewire *ow) {
+  GPIO.pin[ow->pin].pad_driver = 1;
+}
+
+void onewire_uart_write_bytes(struct mgos_uart_onewire *ow, const uint8_t *buf,
+                              int len) {
+  onewire_uart_xfer_bytes(ow, buf, NULL, len);
+}
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Cost model of the bus time of the RMT and UART 1-Wire backends.
+
+Usage: ow_backend_model.py --bench FILE [--devices N]
+       ow_backend_model.py --rmt-overhead US --uart-overhead US [--devices N]
+
+This is an analytical model, not a benchmark: it doesn't run the drivers.
+It counts the driver round trips the two backends issue for typical Dallas
+operations (onewire_rmt.c / onewire_uart.c chunking) and charges each one
+the nominal duration of its slots plus a fixed overhead. The overheads have
+no default, they are measured on the target by the OW.Bench RPC (build with
+OW_BENCH): --bench takes its JSON response, e.g.
+  mos call OW.Bench '{"bytes": 100}' > bench.json
+"""
+
+import argparse
+import json
+
+# RMT backend (onewire_rmt.c)
+RMT_SLOT = 75.0
+RMT_RESET = 480.0 + 480.0  # low pulse + idle threshold wait for presence
+RMT_STREAM_CHUNK = 7  # bytes per read round trip with 1 RX memory block
+
+# UART backend (onewire_uart.c)
+UART_SLOT = 10 * 1e6 / 115200  # one UART byte per slot
+UART_RESET = 10 * 1e6 / 9600
+UART_CHUNK = 16  # 1-Wire bytes per FIFO transfer
+
+
+class Backend:
+    def __init__(self, name, overhead):
+        self.name = name
+        self.overhead = overhead
+        self.time = 0.0
+        self.calls = 0
+
+    def call(self, duration):
+        self.calls += 1
+        self.time += self.overhead + duration
+
+
+class Rmt(Backend):
+    def reset(self):
+        self.call(RMT_RESET)
+
+    def write(self, n):
+        # onewire_rmt_write_bytes: one round trip per byte
+        for _ in range(n):
+            self.call(8 * RMT_SLOT)
+
+    def read(self, n):
+        while n > 0:
+            chunk = min(n, RMT_STREAM_CHUNK)
+            self.call(8 * chunk * RMT_SLOT)
+            n -= chunk
+
+    def bits(self, n):
+        self.call(n * RMT_SLOT)
+
+    def triplet(self):
+        # id bit and complement read separately, then the direction written
+        self.bits(1)
+        self.bits(1)
+        self.bits(1)
+
+
+class Uart(Backend):
+    def reset(self):
+        # two extra baud rate switches are included in the overhead
+        self.call(UART_RESET)
+
+    def write(self, n):
+        while n > 0:
+            chunk = min(n, UART_CHUNK)
+            self.call(8 * chunk * UART_SLOT)
+            n -= chunk
+
+    read = write
+
+    def bits(self, n):
+        self.call(n * UART_SLOT)
+
+    def triplet(self):
+        self.bits(2)
+        self.bits(1)
+
+
+def read_temperatures(bus, devices):
+    # requestTemperatures (no wait) + getTempC for every device
+    bus.reset()
+    bus.write(2)  # skip rom + convert
+    for _ in range(devices):
+        bus.reset()
+        bus.write(1 + 8 + 1)  # match rom + rom + read scratchpad
+        bus.read(9)
+
+
+def search(bus, devices):
+    for _ in range(devices):
+        bus.reset()
+        bus.write(1)
+        for _ in range(64):
+            bus.triplet()
+
+
+def read_eeprom(bus, size):
+    bus.reset()
+    bus.write(1 + 8 + 3)
+    bus.read(size)
+    bus.reset()
+
+
+def bench_overheads(path):
+    # OW.Bench writes one byte per driver round trip with both backends
+    with open(path) as f:
+        res = json.load(f)
+    return (res['virtual']['write_us'] - 8 * RMT_SLOT,
+            res['uart']['write_us'] - 8 * UART_SLOT)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--devices', type=int, default=10)
+    parser.add_argument('--bench',
+                        help='response of the OW.Bench RPC measured on the '
+                        'target')
+    parser.add_argument('--rmt-overhead', type=float,
+                        help='measured us per RMT driver round trip')
+    parser.add_argument('--uart-overhead', type=float,
+                        help='measured us per UART driver round trip')
+    args = parser.parse_args()
+    if args.bench:
+        rmt_overhead, uart_overhead = bench_overheads(args.bench)
+    elif args.rmt_overhead is not None and args.uart_overhead is not None:
+        rmt_overhead, uart_overhead = args.rmt_overhead, args.uart_overhead
+    else:
+        parser.error('--bench or both --rmt-overhead and --uart-overhead '
+                     'are required')
+    print('round trip overhead: RMT %.1f us, UART %.1f us' %
+          (rmt_overhead, uart_overhead))
+
+    ops = [
+        ('read %d sensors' % args.devices,
+         lambda b: read_temperatures(b, args.devices)),
+        ('search %d devices' % args.devices, lambda b: search(b, args.devices)),
+        ('read 128 B EEPROM', lambda b: read_eeprom(b, 128)),
+        ('read 2560 B EEPROM', lambda b: read_eeprom(b, 2560)),
+    ]
+    print('%-22s %14s %8s %14s %8s' % ('operation', 'RMT [ms]', 'calls',
+                                        'UART [ms]', 'calls'))
+    for name, op in ops:
+        rmt = Rmt('rmt', rmt_overhead)
+        uart = Uart('uart', uart_overhead)
+        op(rmt)
+        op(uart)
+        print('%-22s %14.2f %8d %14.2f %8d' % (name, rmt.time / 1000,
+                                                rmt.calls, uart.time / 1000,
+                                                uart.calls))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Convert a 1-Wire RMT trace dump (OW.TraceDump) to a VCD file for GTKWave.
+
+Usage: ow_trace2vcd.py ow_trace.bin [ow_trace.vcd]
+
+Every frame of RMT items becomes a waveform starting at the frame time:
+the `tx_<gpio>` signal shows what the RMT TX channel drove and `rx_<gpio>`
+what the RX channel sampled on the bus. The time scale is 1us.
+"""
+
+import struct
+import sys
+
+HEADER = struct.Struct('<4sHHII')
+RECORD = struct.Struct('<IBBHI')
+TX, RX = 0, 1
+
+
+def read_frames(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic, version, record_size, count, _ = HEADER.unpack_from(data, 0)
+    if magic != b'OWTR' or version != 1 or record_size != RECORD.size:
+        raise ValueError('%s is not a 1-Wire trace dump' % path)
+
+    frames = []
+    for i in range(count):
+        time, typ, gpio, index, item = RECORD.unpack_from(
+            data, HEADER.size + i * RECORD.size)
+        # records of the same frame share the time, a new frame starts at
+        # index 0 (or at a wrapped, partially overwritten frame)
+        if (index == 0 or not frames or frames[-1][0] != time or
+                frames[-1][1] != typ or frames[-1][2] != gpio):
+            frames.append((time, typ, gpio, []))
+        frames[-1][3].append(item)
+    return frames
+
+
+def frame_edges(start, items):
+    """Yield (time, level) of the levels of the RMT items."""
+    t = start
+    for item in items:
+        for duration, level in ((item & 0x7FFF, (item >> 15) & 1),
+                                ((item >> 16) & 0x7FFF, item >> 31)):
+            if duration == 0:
+                # end marker or idle
+                yield t, 1
+                return
+            yield t, level
+            t += duration
+    yield t, 1
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    src = sys.argv[1]
+    dst = sys.argv[2] if len(sys.argv) > 2 else src.rsplit('.', 1)[0] + '.vcd'
+
+    frames = read_frames(src)
+    if not frames:
+        sys.exit('empty trace')
+
+    # unwrap the 32 bit microsecond timestamps
+    base = frames[0][0]
+    offset = 0
+    prev = base
+    changes = []
+    signals = {}
+    for time, typ, gpio, items in frames:
+        if time < prev and prev - time > 0x80000000:
+            offset += 1 << 32
+        prev = time
+        name = '%s_%d' % ('tx' if typ == TX else 'rx', gpio)
+        ident = signals.setdefault(name, chr(33 + len(signals)))
+        for t, level in frame_edges(time + offset - base, items):
+            changes.append((t, ident, level))
+
+    changes.sort(key=lambda c: c[0])
+    with open(dst, 'w') as out:
+        out.write('$timescale 1us $end\n$scope module onewire $end\n')
+        for name, ident in sorted(signals.items()):
+            out.write('$var wire 1 %s %s $end\n' % (ident, name))
+        out.write('$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n')
+        for ident in signals.values():
+            out.write('1%s\n' % ident)
+        out.write('$end\n')
+        last = {}
+        now = 0
+        for t, ident, level in changes:
+            if last.get(ident) == level:
+                continue
+            if t != now:
+                out.write('#%d\n' % t)
+                now = t
+            out.write('%d%s\n' % (level, ident))
+            last[ident] = level
+    print('%d frames written to %s' % (len(frames), dst))
+
+
+if __name__ == '__main__':
+    main()